@@ -0,0 +1,489 @@
+#include "allocation_counter.hpp"
+#include <benchmark/benchmark.h>
+#include <tetris/ai.hpp>
+#include <tetris/batch_eval.hpp>
+#include <tetris/board.hpp>
+#include <tetris/game.hpp>
+#include <tetris/game_batch.hpp>
+#include <tetris/move_generator.hpp>
+#include <tetris/multiplayer.hpp>
+#include <tetris/randomizer.hpp>
+#include <tetris/thread_pool.hpp>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Play a fixed number of AI moves so the board holds a realistic mid-game
+// stack instead of an empty grid.
+void playMoves(tetris::Game &game, tetris::AI &ai, int moves) {
+    for (int i = 0; i < moves && game.getState() == tetris::GameState::PLAYING;
+         i++) {
+        tetris::AI::Move move = ai.findBestMove(game);
+        if (!game.applyPlacement(move.rotation, {move.x, move.y})) {
+            game.drop();
+        }
+    }
+}
+
+// Drop pieces across the columns without any plan until some column is
+// height cells tall
+void stackUp(tetris::Game &game, int height) {
+    for (int i = 0; game.getState() == tetris::GameState::PLAYING; i++) {
+        const tetris::Board &board = game.getBoard();
+        int highest = 0;
+        for (int x = 0; x < board.getWidth(); x++) {
+            highest = std::max(highest, board.getColumnHeight(x));
+        }
+        if (highest >= height) {
+            return;
+        }
+
+        int target = (i * 3) % tetris::BOARD_WIDTH;
+        for (int step = 0; step < tetris::BOARD_WIDTH; step++) {
+            if (game.getCurrentPosition().x < target) {
+                game.moveRight();
+            } else if (game.getCurrentPosition().x > target) {
+                game.moveLeft();
+            }
+        }
+        game.drop();
+    }
+}
+
+// Board states shared by the benchmarks, selected by the fixture argument
+enum Fixture { EMPTY = 0, MID_GAME = 1, NEAR_TOP_OUT = 2 };
+
+constexpr std::uint64_t FIXTURE_SEED = 2024;
+
+tetris::Game makeGame(int fixture) {
+    tetris::Game game(FIXTURE_SEED);
+    if (fixture == MID_GAME) {
+        tetris::AI ai;
+        playMoves(game, ai, 30);
+    } else if (fixture == NEAR_TOP_OUT) {
+        stackUp(game, 16);
+    }
+    return game;
+}
+
+// Report heap allocations per item and fail the benchmark if there were
+// any, for paths that must not allocate once set up. Count inside the timed
+// loop, starting the loop allocates in the framework.
+void expectNoAllocations(benchmark::State &state, std::uint64_t allocations,
+                         std::int64_t items) {
+    state.counters["allocs/item"] =
+        items > 0 ? static_cast<double>(allocations) / static_cast<double>(items) : 0.0;
+    if (allocations != 0) {
+        state.SkipWithError("heap allocations in the steady state");
+    }
+}
+
+void addFixtureArgs(benchmark::internal::Benchmark *bench) {
+    bench->ArgName("fixture")->Arg(EMPTY)->Arg(MID_GAME)->Arg(NEAR_TOP_OUT);
+}
+
+// A board whose bottom full_rows rows are full, with a few loose cells above
+// them. Each row gets two horizontal I pieces and O pieces fill the last two
+// columns in pairs of rows, so an odd count leaves half an O above.
+tetris::Board makeFullRows(int full_rows) {
+    tetris::Board board;
+    tetris::Tetromino i_piece(tetris::TetrominoType::I);
+    tetris::Tetromino o_piece(tetris::TetrominoType::O);
+    int top = tetris::BOARD_HEIGHT - full_rows;
+    for (int y = tetris::BOARD_HEIGHT - 1; y >= top; y--) {
+        board.place(i_piece, {0, y});
+        board.place(i_piece, {4, y});
+    }
+    for (int y = tetris::BOARD_HEIGHT - 2; y >= top - 1 && full_rows > 0; y -= 2) {
+        board.place(o_piece, {8, y});
+    }
+    board.place(o_piece, {0, top - 3});
+    board.place(i_piece, {3, top - 2});
+    return board;
+}
+
+// Every spot where piece rests after a hard drop, as findBestMove tries them
+std::vector<tetris::Position> landingSpots(const tetris::Board &board,
+                                           const tetris::Tetromino &piece) {
+    std::vector<tetris::Position> spots;
+    for (int x = -3; x < board.getWidth() + 3; x++) {
+        tetris::Position pos{x, 0};
+        while (board.canPlace(piece, pos)) {
+            pos.y++;
+        }
+        if (pos.y > 0) {
+            spots.push_back({x, pos.y - 1});
+        }
+    }
+    return spots;
+}
+
+} // namespace
+
+// Searching the same position over and over would be answered from the
+// transposition table, so throughput benchmarks run without it
+constexpr int NO_TABLE = 0;
+
+// Collision tests for every piece, rotation and in-bounds offset
+static void BM_CanPlace(benchmark::State &state) {
+    tetris::Board board = makeGame(static_cast<int>(state.range(0))).getBoard();
+    std::vector<tetris::Tetromino> pieces;
+    for (int type = 0; type < tetris::NUM_TETROMINO_TYPES; type++) {
+        tetris::Tetromino piece(static_cast<tetris::TetrominoType>(type));
+        for (int r = 0; r < tetris::NUM_ROTATIONS; r++) {
+            pieces.push_back(piece);
+            piece.rotate();
+        }
+    }
+
+    std::int64_t tests = 0;
+    for (auto _ : state) {
+        for (const tetris::Tetromino &piece : pieces) {
+            for (int y = 0; y < tetris::BOARD_HEIGHT; y++) {
+                for (int x = -1; x < tetris::BOARD_WIDTH; x++) {
+                    benchmark::DoNotOptimize(board.canPlace(piece, {x, y}));
+                }
+            }
+        }
+        tests += static_cast<std::int64_t>(pieces.size()) * tetris::BOARD_HEIGHT *
+                 (tetris::BOARD_WIDTH + 1);
+    }
+    state.SetItemsProcessed(tests);
+}
+BENCHMARK(BM_CanPlace)->Apply(addFixtureArgs);
+
+// Clearing 0 to 4 full rows. Each iteration clears a fresh copy, so the
+// 0-row case doubles as the cost of the copy.
+static void BM_ClearLines(benchmark::State &state) {
+    tetris::Board full = makeFullRows(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        tetris::Board board = full;
+        benchmark::DoNotOptimize(board.clearLines());
+        benchmark::DoNotOptimize(board);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ClearLines)->ArgName("rows")->DenseRange(0, 4);
+
+// One rotation of each of the seven pieces per iteration
+static void BM_Rotate(benchmark::State &state) {
+    std::vector<tetris::Tetromino> pieces;
+    for (int type = 0; type < tetris::NUM_TETROMINO_TYPES; type++) {
+        pieces.emplace_back(static_cast<tetris::TetrominoType>(type));
+    }
+    for (auto _ : state) {
+        for (tetris::Tetromino &piece : pieces) {
+            piece.rotate();
+            benchmark::DoNotOptimize(piece);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * tetris::NUM_TETROMINO_TYPES);
+}
+BENCHMARK(BM_Rotate);
+
+// Drawing pieces: 0 = uniform, 1 = 7-bag
+static void BM_NextPiece(benchmark::State &state) {
+    tetris::Randomizer randomizer(FIXTURE_SEED,
+                                  static_cast<tetris::RandomizerKind>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(randomizer.next());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_NextPiece)->ArgName("bag")->Arg(0)->Arg(1);
+
+// Scoring every hard-drop landing spot of a T piece, one call each
+static void BM_EvaluatePosition(benchmark::State &state) {
+    tetris::Board board = makeGame(static_cast<int>(state.range(0))).getBoard();
+    tetris::Tetromino piece(tetris::TetrominoType::T);
+    std::vector<tetris::Position> spots = landingSpots(board, piece);
+    tetris::AI ai;
+    for (auto _ : state) {
+        for (tetris::Position pos : spots) {
+            benchmark::DoNotOptimize(ai.evaluatePosition(board, piece, pos));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(spots.size()));
+}
+BENCHMARK(BM_EvaluatePosition)->Apply(addFixtureArgs);
+
+static void BM_FindBestMove(benchmark::State &state) {
+    tetris::AI ai({1, 1, NO_TABLE});
+    tetris::Game game = makeGame(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ai.findBestMove(game));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindBestMove)->Apply(addFixtureArgs);
+
+// Reachable placements of the current piece, then the input path to each
+static void BM_GenerateMoves(benchmark::State &state) {
+    tetris::Game game = makeGame(static_cast<int>(state.range(0)));
+    tetris::MoveGenerator generator;
+    tetris::InputPath path;
+    std::size_t placements = 0;
+    for (auto _ : state) {
+        const auto &generated = generator.generate(game.getBoard(), game.getCurrentPiece(),
+                                                   game.getCurrentPosition());
+        benchmark::DoNotOptimize(generated.data());
+        placements = generated.size();
+    }
+    state.counters["placements"] = static_cast<double>(placements);
+    state.SetItemsProcessed(state.iterations());
+
+    // Paths are only planned for the chosen move, time one for reference
+    const auto &generated = generator.generate(game.getBoard(), game.getCurrentPiece(),
+                                               game.getCurrentPosition());
+    if (!generated.empty()) {
+        auto start = std::chrono::steady_clock::now();
+        generator.findPath(generated.back(), path);
+        std::chrono::duration<double, std::nano> took = std::chrono::steady_clock::now() - start;
+        state.counters["path_ns"] = took.count();
+    }
+}
+BENCHMARK(BM_GenerateMoves)->Apply(addFixtureArgs);
+
+// Hard drop, lock, line clear and spawn on a fresh copy of the game
+static void BM_GameDrop(benchmark::State &state) {
+    tetris::Game start = makeGame(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        tetris::Game game = start;
+        game.drop();
+        benchmark::DoNotOptimize(game);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GameDrop)->Apply(addFixtureArgs);
+
+// A whole piece: search, steer the piece along the chosen path, lock, clear
+// and spawn. Args are depth and beam width. Fails if anything allocates.
+static void BM_PlayPiece(benchmark::State &state) {
+    int depth = static_cast<int>(state.range(0));
+    tetris::Game game(FIXTURE_SEED);
+    game.setPreviewSize(depth - 1);
+    tetris::AI ai({depth, static_cast<int>(state.range(1))});
+    std::uint64_t allocations = 0;
+    for (auto _ : state) {
+        tetris::testing::AllocationScope scope;
+        if (game.getState() != tetris::GameState::PLAYING) {
+            game.reset();
+        }
+        game.applyPath(ai.findBestMove(game).path);
+        allocations += scope.count();
+    }
+    state.SetItemsProcessed(state.iterations());
+    expectNoAllocations(state, allocations, state.iterations());
+}
+BENCHMARK(BM_PlayPiece)->Args({1, 1})->Args({3, 8})->Unit(benchmark::kMicrosecond);
+
+// BM_PlayPiece with the greedy AI on each compiled board size, to see how
+// the search scales with the board
+template <int Width, int Height>
+static void BM_PlayPieceOnBoard(benchmark::State &state) {
+    tetris::BasicGame<Width, Height> game(FIXTURE_SEED);
+    tetris::BasicAI<Width, Height> ai;
+    std::uint64_t allocations = 0;
+    for (auto _ : state) {
+        tetris::testing::AllocationScope scope;
+        if (game.getState() != tetris::GameState::PLAYING) {
+            game.reset();
+        }
+        game.applyPath(ai.findBestMove(game).path);
+        allocations += scope.count();
+    }
+    state.SetItemsProcessed(state.iterations());
+    expectNoAllocations(state, allocations, state.iterations());
+}
+#define TETRIS_BENCHMARK_BOARD(W, H)                                                   \
+    BENCHMARK_TEMPLATE(BM_PlayPieceOnBoard, W, H)->Unit(benchmark::kMicrosecond);
+TETRIS_BOARD_SIZES(TETRIS_BENCHMARK_BOARD)
+#undef TETRIS_BENCHMARK_BOARD
+
+// One multiplayer tick, every player placing a piece on all cores
+static void BM_MultiPlayerUpdate(benchmark::State &state) {
+    int players = static_cast<int>(state.range(0));
+    tetris::MultiPlayerGame match(players, FIXTURE_SEED);
+    std::int64_t pieces = 0;
+    for (auto _ : state) {
+        int active = match.getActivePlayers();
+        if (active == 0) {
+            state.PauseTiming();
+            match.reset();
+            state.ResumeTiming();
+            active = players;
+        }
+        match.update();
+        pieces += active;
+    }
+    state.SetItemsProcessed(pieces);
+}
+BENCHMARK(BM_MultiPlayerUpdate)
+    ->ArgName("players")
+    ->RangeMultiplier(2)
+    ->Range(2, 64)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// One lockstep step of a batch of games on all cores. Finished games are
+// restarted between steps, so every step places a piece in every game.
+static void BM_GameBatchStep(benchmark::State &state) {
+    int games = static_cast<int>(state.range(0));
+    tetris::GameBatch batch(games, FIXTURE_SEED);
+    std::int64_t pieces = 0;
+    std::uint64_t allocations = 0;
+    for (auto _ : state) {
+        int active = batch.getActiveGames();
+        if (active < games) {
+            state.PauseTiming();
+            batch.reset();
+            state.ResumeTiming();
+            active = games;
+        }
+        tetris::testing::AllocationScope scope;
+        batch.step();
+        allocations += scope.count();
+        pieces += active;
+    }
+    state.SetItemsProcessed(pieces);
+    state.counters["bytes/game"] = static_cast<double>(batch.getMemoryUsage()) / games;
+    expectNoAllocations(state, allocations, pieces);
+}
+BENCHMARK(BM_GameBatchStep)
+    ->ArgName("games")
+    ->Arg(1000)
+    ->Arg(10000)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// The same step over separately allocated Game objects sharing one AI, as
+// games were stored before the batch
+static void BM_GameObjectsStep(benchmark::State &state) {
+    int games = static_cast<int>(state.range(0));
+    std::vector<std::unique_ptr<tetris::Game>> objects;
+    for (int i = 0; i < games; i++) {
+        auto seed = tetris::mixBits(FIXTURE_SEED + static_cast<std::uint64_t>(i));
+        objects.push_back(std::make_unique<tetris::Game>(seed));
+    }
+    tetris::AI ai;
+    std::int64_t pieces = 0;
+    for (auto _ : state) {
+        for (auto &game : objects) {
+            if (game->getState() != tetris::GameState::PLAYING) {
+                game->reset();
+            }
+            playMoves(*game, ai, 1);
+        }
+        pieces += games;
+    }
+    state.SetItemsProcessed(pieces);
+}
+BENCHMARK(BM_GameObjectsStep)
+    ->ArgName("games")
+    ->Arg(1000)
+    ->Arg(10000)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Score 64 mid-game candidate boards (one piece's worth) per iteration with
+// the kernel selected by the argument: 0 = scalar, 1 = SSE2, 2 = AVX2
+static void BM_BatchEvaluate(benchmark::State &state) {
+    tetris::Game game = makeGame(MID_GAME);
+
+    tetris::BatchEvaluator batch;
+    for (int i = 0; i < 64; i++) {
+        batch.add(game.getBoard(), i % 3);
+    }
+    auto level = static_cast<tetris::SimdLevel>(state.range(0));
+    std::vector<int> scores;
+    for (auto _ : state) {
+        batch.evaluate(scores, level);
+        benchmark::DoNotOptimize(scores.data());
+    }
+    state.SetItemsProcessed(state.iterations() * batch.size());
+}
+BENCHMARK(BM_BatchEvaluate)->Arg(0)->Arg(1)->Arg(2);
+
+// Beam search throughput: args are depth and beam width
+static void BM_BeamSearch(benchmark::State &state) {
+    tetris::Game game = makeGame(MID_GAME);
+    game.setPreviewSize(static_cast<int>(state.range(0)) - 1);
+
+    tetris::AI ai(
+        {static_cast<int>(state.range(0)), static_cast<int>(state.range(1)), NO_TABLE});
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ai.findBestMove(game));
+    }
+    state.counters["nodes/s"] = benchmark::Counter(
+        static_cast<double>(ai.getNodesSearched()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_BeamSearch)
+    ->Args({1, 1})
+    ->Args({3, 8})
+    ->Args({4, 8})
+    ->Args({5, 8})
+    ->Args({5, 16})
+    ->Unit(benchmark::kMicrosecond);
+
+// Beam search scaling: depth 4, beam 16 on a pool with the argument's number
+// of threads, from 1 up to every core
+static void BM_ParallelBeamSearch(benchmark::State &state) {
+    tetris::Game game = makeGame(MID_GAME);
+    game.setPreviewSize(3);
+
+    tetris::ThreadPool pool(static_cast<int>(state.range(0)));
+    tetris::AI ai({4, 16, NO_TABLE});
+    ai.setThreadPool(&pool);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ai.findBestMove(game));
+    }
+    state.counters["nodes/s"] = benchmark::Counter(
+        static_cast<double>(ai.getNodesSearched()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ParallelBeamSearch)
+    ->Apply([](benchmark::internal::Benchmark *bench) {
+        int cores = static_cast<int>(std::thread::hardware_concurrency());
+        for (int threads = 1; threads < cores; threads *= 2) {
+            bench->Arg(threads);
+        }
+        bench->Arg(std::max(cores, 1));
+    })
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// Move quality: play capped games and report lines cleared and survival.
+// Args are depth and beam width; depth 1 is the greedy player.
+static void BM_PlayQuality(benchmark::State &state) {
+    constexpr int PIECE_CAP = 1000;
+    int depth = static_cast<int>(state.range(0));
+    double lines = 0;
+    double pieces = 0;
+    double games = 0;
+    double hit_rate = 0;
+    for (auto _ : state) {
+        tetris::Game game;
+        game.setPreviewSize(depth - 1);
+        tetris::AI ai({depth, static_cast<int>(state.range(1))});
+        int placed = 0;
+        for (; placed < PIECE_CAP && game.getState() == tetris::GameState::PLAYING;
+             placed++) {
+            playMoves(game, ai, 1);
+        }
+        lines += game.getLinesCleared();
+        pieces += placed;
+        hit_rate += ai.getTranspositionTable().getHitRate();
+        games++;
+    }
+    state.counters["lines/game"] = lines / games;
+    state.counters["pieces/game"] = pieces / games;
+    state.counters["tt_hit_rate"] = hit_rate / games;
+}
+BENCHMARK(BM_PlayQuality)
+    ->Args({1, 1})
+    ->Args({3, 8})
+    ->Iterations(5)
+    ->Unit(benchmark::kMillisecond);
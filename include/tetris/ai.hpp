@@ -1,31 +1,186 @@
 #pragma once
 
+#include "batch_eval.hpp"
 #include "game.hpp"
+#include "move_generator.hpp"
+#include "thread_pool.hpp"
+#include "transposition_table.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
 
 namespace tetris {
 
-class AI {
+// The parts of the AI interface every board size shares
+class AIBase {
   public:
-    AI();
-
-    // Evaluate a position and return a score
-    int evaluatePosition(const Board &board, const Tetromino &piece,
-                         Position pos);
+    // How far ahead the AI looks. Depth 1 is the greedy one-piece search.
+    // Deeper searches also place the next depth - 1 preview pieces and keep
+    // the beam_width best boards at every level.
+    struct SearchConfig {
+        int depth = 1;
+        int beam_width = 8;
+        // Transposition table size in 64-byte buckets, 0 disables it
+        int table_buckets = 1024;
+        // Threads findBestMove may use when no pool is injected, counting the
+        // caller. 1 searches serially, 0 uses every core.
+        int threads = 1;
+    };
 
-    // Find the best move for the current piece
+    // A move for the current piece: where it should lock, and the inputs
+    // that take it there from its current state
     struct Move {
         int rotation;
         int x;
+        int y;
         int score;
+        InputPath path;
+    };
+};
+
+// The AI for a Width x Height board, compiled for every size in
+// TETRIS_BOARD_SIZES. AI plays the standard board.
+template <int Width, int Height>
+class BasicAI : public AIBase {
+  public:
+    using Board = BasicBoard<Width, Height>;
+    using Game = BasicGame<Width, Height>;
+
+    BasicAI();
+    explicit BasicAI(const SearchConfig &config);
+
+    // Changing table_buckets or threads here has no effect, the table and
+    // the pool are set up once
+    void setSearchConfig(const SearchConfig &config) { config_ = config; }
+    const SearchConfig &getSearchConfig() const { return config_; }
+
+    // Result boards evaluated by findBestMove since construction
+    std::int64_t getNodesSearched() const { return nodes_searched_; }
+    const TranspositionTable &getTranspositionTable() const { return table_; }
+
+    // Share a pool with other AIs instead of the one sized by
+    // SearchConfig::threads. nullptr goes back to the AI's own pool. The
+    // chosen move is the same whichever pool searches.
+    void setThreadPool(ThreadPool *pool);
+    ThreadPool *getThreadPool() const { return pool_; }
+
+    // Weights of the evaluation features. Setting them clears the
+    // transposition table, whose scores were computed with the old ones.
+    void setWeights(const EvalWeights &weights);
+    const EvalWeights &getWeights() const { return weights_; }
+
+    // Evaluate a position and return a score
+    int evaluatePosition(const Board &board, const Tetromino &piece,
+                         Position pos);
+
+    // The part of a game a search looks at, for games that are not Game
+    // objects
+    struct SearchRoot {
+        const Board *board;
+        Tetromino piece;
+        Position pos;
+        // Upcoming pieces, preview[0] spawns next
+        const TetrominoType *preview;
+        int preview_size;
     };
 
     Move findBestMove(const Game &game);
+    Move findBestMove(const SearchRoot &root);
 
   private:
+    using MoveGenerator = BasicMoveGenerator<Width, Height>;
+    using BatchEvaluator = BasicBatchEvaluator<Width>;
+    using PlacementUndo = typename Board::Undo;
+    using Placement = typename MoveGenerator::Placement;
+
+    // A reachable landing spot for one piece
+    struct Candidate {
+        int rotation;
+        Position pos;
+        // Hash of the placement outcome, and its lane in batch_ (-1 when the
+        // score came from the transposition table)
+        std::uint64_t key;
+        int batch_index;
+    };
+
+    // A board kept in the beam, with the first move that led to it
+    struct BeamNode {
+        Board board;
+        Move first_move;
+        int cleared_lines;
+        int score;
+    };
+
+    // A scored expansion of a beam node, materialized only if it survives
+    struct Child {
+        int parent;
+        int candidate;
+        int score;
+    };
+
+    // Scratch for scoring the placements of one piece on one board. Each
+    // parallel task gets its own.
+    struct Workspace {
+        MoveGenerator generator;
+        BatchEvaluator batch;
+        std::vector<Candidate> candidates;
+        std::vector<int> scores;
+        std::vector<int> batch_scores;
+
+        Workspace();
+    };
+
+    SearchConfig config_;
+    EvalWeights weights_;
+    std::int64_t nodes_searched_;
+    TranspositionTable table_;
+    std::unique_ptr<ThreadPool> own_pool_;
+    ThreadPool *pool_;
+
+    // Reused across searches and sized for the search config up front, so
+    // searches do not allocate
+    MoveGenerator root_generator_;
+    Workspace workspace_;
+    std::vector<Workspace> task_workspaces_;
+    std::vector<Board> task_boards_;
+    std::vector<BeamNode> beam_;
+    std::vector<BeamNode> next_beam_;
+    // Sorted keys of the boards in next_beam_, to drop transpositions
+    std::vector<std::uint64_t> beam_keys_;
+    std::vector<Child> children_;
+    std::vector<Candidate> child_candidates_;
+
+    // Fill the workspace with the scores of placements [first, last) of a
+    // piece of the given type. base_cleared_lines is added to each
+    // candidate's cleared line count. Cached scores are used only when table
+    // is given, so tasks on other threads pass nullptr.
+    void scoreCandidates(Workspace &workspace, Board &board, TetrominoType type,
+                         const Placement *first, const Placement *last,
+                         int base_cleared_lines, TranspositionTable *table);
+    // Remember the scores the workspace had to compute
+    void storeScores(const Workspace &workspace);
+    bool searchParallel() const { return pool_ != nullptr && pool_->getNumThreads() > 1; }
+    // Make sure there is a workspace for every task of a parallel step
+    void prepareTasks(std::size_t count);
+    Move findBestMoveGreedy(const SearchRoot &root);
+    // Fill in the inputs for a move chosen among root_generator_'s placements
+    void planPath(Move &move);
+    Move findBestMoveBeam(const SearchRoot &root, int depth);
+
+    // Score a placement that is known to fit, using make/unmake on board
+    int evaluatePlacement(Board &board, const Tetromino &piece, Position pos);
+    int scoreBoard(const Board &board, int cleared_lines);
+
     int calculateHeight(const Board &board);
     int countHoles(const Board &board);
     int calculateBumpiness(const Board &board);
     int countCompletedLines(const Board &board);
 };
 
+#define TETRIS_DECLARE_AI(W, H) extern template class BasicAI<W, H>;
+TETRIS_BOARD_SIZES(TETRIS_DECLARE_AI)
+#undef TETRIS_DECLARE_AI
+
+using AI = BasicAI<BOARD_WIDTH, BOARD_HEIGHT>;
+
 } // namespace tetris
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "board.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace tetris {
+
+// Heuristic weights from
+// https://codemyroad.wordpress.com/2013/04/14/tetris-ai-the-near-perfect-player/
+constexpr double LINES_WEIGHT = 0.760666;
+constexpr double HEIGHT_WEIGHT = -0.510066;
+constexpr double HOLES_WEIGHT = -0.35663;
+constexpr double BUMPINESS_WEIGHT = -0.184483;
+
+// Evaluator weights, settable at runtime so they can be tuned
+struct EvalWeights {
+    double lines = LINES_WEIGHT;
+    double height = HEIGHT_WEIGHT;
+    double holes = HOLES_WEIGHT;
+    double bumpiness = BUMPINESS_WEIGHT;
+};
+
+// Scalar scoring shared by AI::evaluatePosition and the batch kernels. The
+// SIMD kernels perform the same double operations in the same order, so
+// every path produces bit-identical scores.
+inline int scoreFeatures(const EvalWeights &weights, int cleared_lines, int height,
+                         int holes, int bumpiness) {
+    double score = 0.0;
+    score += cleared_lines * weights.lines; // Reward line clears
+    score += height * weights.height;       // Penalize aggregate height
+    score += holes * weights.holes;         // Penalize holes
+    score += bumpiness * weights.bumpiness; // Penalize bumpiness
+
+    // Scale to integer for comparison (multiply by 1000 to maintain precision)
+    return static_cast<int>(score * 1000);
+}
+
+enum class SimdLevel { SCALAR, SSE2, AVX2 };
+
+// Best kernel the running CPU supports, detected once
+SimdLevel detectSimdLevel();
+
+// Collects the features of many candidate result boards (one piece's
+// placements, or the boards of many players) in structure-of-arrays form
+// and scores them all at once. Boards of every height share the evaluator
+// for their width, whose kernels run with the width as a constant.
+template <int Width>
+class BasicBatchEvaluator {
+  public:
+    static constexpr int LANES = 8;
+
+    // Features of LANES candidates, one lane per candidate
+    struct alignas(32) Block {
+        std::int32_t heights[static_cast<std::size_t>(Width)][LANES];
+        std::int32_t holes[LANES];
+        std::int32_t cleared[LANES];
+    };
+
+    void setWeights(const EvalWeights &weights) { weights_ = weights; }
+    const EvalWeights &getWeights() const { return weights_; }
+
+    void clear() { size_ = 0; }
+    // Make room for boards candidates so add() does not allocate
+    void reserve(int boards) {
+        blocks_.reserve(static_cast<std::size_t>((boards + LANES - 1) / LANES));
+    }
+    template <int Height>
+    void add(const BasicBoard<Width, Height> &board, int cleared_lines);
+    int size() const { return size_; }
+
+    // Writes size() scores, identical to AI::evaluatePosition for each board
+    void evaluate(std::vector<int> &scores) const;
+    void evaluate(std::vector<int> &scores, SimdLevel level) const;
+
+  private:
+    std::vector<Block> blocks_;
+    int size_ = 0;
+    EvalWeights weights_;
+};
+
+#define TETRIS_DECLARE_BATCH_EVALUATOR(W, H)                                           \
+    extern template class BasicBatchEvaluator<W>;                                      \
+    extern template void BasicBatchEvaluator<W>::add(const BasicBoard<W, H> &, int);
+TETRIS_BOARD_SIZES(TETRIS_DECLARE_BATCH_EVALUATOR)
+#undef TETRIS_DECLARE_BATCH_EVALUATOR
+
+using BatchEvaluator = BasicBatchEvaluator<BOARD_WIDTH>;
+
+} // namespace tetris
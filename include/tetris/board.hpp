@@ -2,30 +2,190 @@
 
 #include "tetromino.hpp"
 #include <array>
+#include <cstdint>
 #include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace tetris {
 
+// Size of the standard board that Board, Game and AI are aliases for
 constexpr int BOARD_WIDTH = 10;
 constexpr int BOARD_HEIGHT = 20;
 
-class Board {
+// Every board size the engine is compiled for, as X(width, height). Each
+// size gets its own BasicBoard, BasicGame and BasicAI, and visitBoardSize()
+// picks among them at runtime. Widths must differ, the batch evaluator is
+// compiled once per width.
+#define TETRIS_BOARD_SIZES(X) X(10, 20) X(16, 40) X(32, 64)
+
+// splitmix64 finalizer, used to derive Zobrist keys
+constexpr std::uint64_t mixBits(std::uint64_t value) {
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+// Narrowest word with a bit for every column of a board Width wide
+template <int Width>
+using RowMaskFor =
+    std::conditional_t<Width <= 16, std::uint16_t,
+                       std::conditional_t<Width <= 32, std::uint32_t, std::uint64_t>>;
+
+// One byte per column, such as a row of piece colors
+template <int Width>
+using ColumnBytes = std::array<std::uint8_t, static_cast<std::size_t>(Width)>;
+
+// Everything BasicBoard::undo() needs to take back one applyPlacement()
+template <int Width, int Height>
+struct BasicPlacementUndo {
+    Tetromino piece;
+    Position pos;
+    int lines_cleared;
+    // Pre-clear indices of the cleared rows, top to bottom, and their colors
+    std::array<std::int8_t, 4> cleared_rows;
+    std::array<ColumnBytes<Width>, 4> cleared_colors;
+    // Statistics from before the placement
+    std::uint64_t hash;
+    ColumnBytes<Width> heights;
+    int aggregate_height;
+    int cell_count;
+    int full_rows;
+};
+
+// A board Width columns wide and Height rows tall. The members are compiled
+// once for every size in TETRIS_BOARD_SIZES, so each size runs with its
+// dimensions as constants.
+template <int Width, int Height>
+class BasicBoard {
   public:
-    Board();
+    static_assert(Width >= 4 && Width <= 64, "Rows must fit a piece and 64 bits");
+    static_assert(Height >= 4 && Height <= 127, "Row indices are kept in std::int8_t");
+
+    static constexpr int WIDTH = Width;
+    static constexpr int HEIGHT = Height;
+
+    // Occupancy of one board row, bit x set when column x is filled
+    using RowMask = RowMaskFor<Width>;
+    static constexpr RowMask FULL_ROW_MASK =
+        static_cast<RowMask>(~std::uint64_t{0} >> (64 - Width));
+    // Piece color per cell, 0 for empty
+    using Cells = std::array<ColumnBytes<Width>, static_cast<std::size_t>(Height)>;
+    using Undo = BasicPlacementUndo<Width, Height>;
+
+    BasicBoard();
 
     bool canPlace(const Tetromino &piece, Position pos) const;
     void place(const Tetromino &piece, Position pos);
     int clearLines();
     bool isGameOver() const;
+
+    // Place a piece and clear lines in a way undo() can reverse exactly.
+    // The piece must fit (canPlace) at pos and the board must not already
+    // hold full rows (asserted), which is always true between clearLines()
+    // calls.
+    Undo applyPlacement(const Tetromino &piece, Position pos);
+    void undo(const Undo &record);
+
     int getCell(int x, int y) const;
     void reset();
+    // Replace the whole board with the given piece colors, such as a board
+    // saved in a replay
+    void loadCells(const Cells &cells);
 
-    int getWidth() const { return BOARD_WIDTH; }
-    int getHeight() const { return BOARD_HEIGHT; }
+    int getWidth() const { return Width; }
+    int getHeight() const { return Height; }
+
+    // Occupancy bitmask of row y (no bounds check)
+    RowMask getRow(int y) const { return rows_[static_cast<std::size_t>(y)]; }
+
+    // Statistics kept up to date by place() and clearLines()
+    int getColumnHeight(int x) const { return heights_[static_cast<std::size_t>(x)]; }
+    const ColumnBytes<Width> &getColumnHeights() const { return heights_; }
+    int getAggregateHeight() const { return aggregate_height_; }
+    // Empty cells with a block somewhere above them in the same column
+    int getHoles() const { return aggregate_height_ - cell_count_; }
+    int getFullRows() const { return full_rows_; }
+    int getRowFill(int y) const;
+    int getBumpiness() const;
+
+    // Zobrist hash of the occupancy (colors are ignored), kept incrementally
+    std::uint64_t getHash() const { return hash_; }
+    // Hash the board would have right after place(piece, pos), before any
+    // lines are cleared. Together with the pre-placement board this fully
+    // determines the outcome of the placement.
+    std::uint64_t getHashAfterPlace(const Tetromino &piece, Position pos) const;
 
   private:
-    std::array<std::array<int, BOARD_WIDTH>, BOARD_HEIGHT> grid_;
+    // Occupancy bitboard used by collision checks and line clears
+    std::array<RowMask, static_cast<std::size_t>(Height)> rows_;
+    // Piece colors, one row per slot. Logical row y keeps its colors in slot
+    // row_slots_[y], so clearing a line relinks its slot to the top instead
+    // of copying every color row above it. Cells whose occupancy bit is clear
+    // may hold stale colors, getCell() masks them out.
+    Cells colors_;
+    std::array<std::uint8_t, static_cast<std::size_t>(Height)> row_slots_;
+    // Height of each column's topmost block, 0 for an empty column
+    ColumnBytes<Width> heights_;
+    int aggregate_height_;
+    int cell_count_;
+    int full_rows_;
+    std::uint64_t hash_;
+
+    void recomputeHeights();
+    void recomputeHash();
+    // XOR of the Zobrist keys of the blocks in row y
+    std::uint64_t getRowHash(int y) const;
+    // Index of the topmost row holding a block, Height for an empty board
+    int getStackTop() const;
+    // Link every row to the slot of the same index
+    void resetSlots();
+    // Drop row y, moving the masks and slot links of the rows from top (the
+    // first one with a block) down to it one row down and its color slot to
+    // row top. Rows above the stack are empty, so they are never touched.
+    // Returns the new stack top.
+    int removeRow(int y, int top);
+    // Reverse of removeRow(): put a full row back at y, moving the rows from
+    // top down to it one row up onto an empty row's slot. Returns the new
+    // stack top.
+    int insertRow(int y, int top);
+};
+
+#define TETRIS_DECLARE_BOARD(W, H) extern template class BasicBoard<W, H>;
+TETRIS_BOARD_SIZES(TETRIS_DECLARE_BOARD)
+#undef TETRIS_DECLARE_BOARD
+
+using Board = BasicBoard<BOARD_WIDTH, BOARD_HEIGHT>;
+using PlacementUndo = Board::Undo;
+using RowMask = Board::RowMask;
+constexpr RowMask FULL_ROW_MASK = Board::FULL_ROW_MASK; // 0x3FF
+
+// A compiled board size as a type, passed to visitBoardSize() visitors
+template <int Width, int Height>
+struct BoardSize {
+    static constexpr int WIDTH = Width;
+    static constexpr int HEIGHT = Height;
 };
 
+// The sizes of TETRIS_BOARD_SIZES as (width, height) pairs
+#define TETRIS_BOARD_SIZE_PAIR(W, H) std::pair<int, int>{W, H},
+inline constexpr std::array BOARD_SIZES = {TETRIS_BOARD_SIZES(TETRIS_BOARD_SIZE_PAIR)};
+#undef TETRIS_BOARD_SIZE_PAIR
+
+// Call visitor(BoardSize<width, height>{}) if the engine is compiled for
+// that size. Returns false, without calling it, if it is not.
+template <typename Visitor>
+bool visitBoardSize(int width, int height, Visitor &&visitor) {
+#define TETRIS_VISIT_BOARD_SIZE(W, H)                                                  \
+    if (width == (W) && height == (H)) {                                               \
+        visitor(BoardSize<W, H>{});                                                    \
+        return true;                                                                   \
+    }
+    TETRIS_BOARD_SIZES(TETRIS_VISIT_BOARD_SIZE)
+#undef TETRIS_VISIT_BOARD_SIZE
+    return false;
+}
+
 } // namespace tetris
@@ -1,17 +1,66 @@
 #pragma once
 
 #include "board.hpp"
+#include "randomizer.hpp"
 #include "tetromino.hpp"
-#include <memory>
-#include <random>
+#include <array>
+#include <cstdint>
 
 namespace tetris {
 
-enum class GameState { PLAYING, GAME_OVER };
+enum class GameState : std::uint8_t { PLAYING, GAME_OVER };
 
-class Game {
+constexpr int MAX_PREVIEW_SIZE = 8;
+constexpr int DEFAULT_PREVIEW_SIZE = 3;
+
+// Where every new piece appears on a board width columns wide, in rotation 0
+constexpr Position spawnPosition(int width) { return {width / 2 - 1, 0}; }
+constexpr Position SPAWN_POSITION = spawnPosition(BOARD_WIDTH);
+
+// One player control, matching the Game method of the same name
+enum class Input : std::uint8_t { LEFT, RIGHT, DOWN, ROTATE, DROP };
+
+// The inputs that take a piece from where it is to where it locks. Paths
+// found by the AI end with DROP.
+struct InputPath {
+    static constexpr int MAX_INPUTS = 64;
+    std::array<Input, MAX_INPUTS> inputs;
+    int length = 0;
+};
+
+// Points for clearing lines at once (1 to 4) on the given level
+int lineClearScore(int lines, int level);
+
+class ReplayRecorder;
+
+// Everything the renderer needs from a game, as plain data so it can be
+// copied between threads with memcpy
+template <int Width, int Height>
+struct BasicGameSnapshot {
+    typename BasicBoard<Width, Height>::Cells cells;
+    TetrominoType piece;
+    std::uint8_t rotation;
+    GameState state;
+    Position pos;
+    int score;
+    int level;
+    int lines;
+};
+
+// A game on a Width x Height board, compiled for every size in
+// TETRIS_BOARD_SIZES. Game is the standard one.
+template <int Width, int Height>
+class BasicGame {
   public:
-    Game();
+    using Board = BasicBoard<Width, Height>;
+    using GameSnapshot = BasicGameSnapshot<Width, Height>;
+
+    static constexpr Position SPAWN_POSITION = spawnPosition(Width);
+
+    BasicGame();
+    // Games built with the same seed and randomizer receive the same pieces
+    explicit BasicGame(std::uint64_t seed,
+                       RandomizerKind randomizer = RandomizerKind::UNIFORM);
 
     void moveLeft();
     void moveRight();
@@ -20,28 +69,67 @@ class Game {
     void drop();
     void update();
     void reset();
+    void applyInput(Input input);
+    void applyPath(const InputPath &path);
+    // Put the current piece straight into its resting spot and lock it, as
+    // if it had been steered there. Returns false and changes nothing if the
+    // piece does not fit there or would keep falling.
+    bool applyPlacement(int rotation, Position pos);
 
     const Board &getBoard() const { return board_; }
-    const Tetromino &getCurrentPiece() const { return *current_piece_; }
+    const Tetromino &getCurrentPiece() const { return current_piece_; }
     Position getCurrentPosition() const { return current_pos_; }
     int getScore() const { return score_; }
     int getLevel() const { return level_; }
     int getLinesCleared() const { return lines_cleared_; }
     GameState getState() const { return state_; }
+    RandomizerKind getRandomizerKind() const { return randomizer_.getKind(); }
+    void captureSnapshot(GameSnapshot &snapshot) const;
+
+    // Report every piece that locks to recorder, nullptr stops recording.
+    // Copies of the game report to the same recorder. Replays hold standard
+    // boards, so other sizes never report.
+    void setRecorder(ReplayRecorder *recorder) { recorder_ = recorder; }
+
+    // Upcoming pieces; index 0 spawns next. Resizing never changes the
+    // order in which pieces arrive, only how many of them are visible.
+    void setPreviewSize(int size);
+    int getPreviewSize() const { return preview_size_; }
+    TetrominoType getPreview(int index) const;
 
   private:
     Board board_;
-    std::unique_ptr<Tetromino> current_piece_;
+    Tetromino current_piece_;
     Position current_pos_;
     int score_;
     int level_;
     int lines_cleared_;
     GameState state_;
-    std::mt19937 rng_;
+    Randomizer randomizer_;
+    // Ring buffer of pieces already drawn from randomizer_ but not yet spawned
+    std::array<TetrominoType, MAX_PREVIEW_SIZE> queue_;
+    int queue_head_;
+    int queue_count_;
+    int preview_size_;
+    ReplayRecorder *recorder_;
+    // The path applyPath() is working through and the inputs of it since
+    // the last lock, so a lock can be recorded with the inputs behind it
+    const InputPath *path_;
+    int path_begin_;
+    int path_end_;
 
+    TetrominoType randomPiece();
+    void fillQueue();
     void spawnNewPiece();
     bool tryMove(int dx, int dy);
     void lockPiece();
 };
 
+#define TETRIS_DECLARE_GAME(W, H) extern template class BasicGame<W, H>;
+TETRIS_BOARD_SIZES(TETRIS_DECLARE_GAME)
+#undef TETRIS_DECLARE_GAME
+
+using Game = BasicGame<BOARD_WIDTH, BOARD_HEIGHT>;
+using GameSnapshot = Game::GameSnapshot;
+
 } // namespace tetris
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "ai.hpp"
+#include "board.hpp"
+#include "game.hpp"
+#include "randomizer.hpp"
+#include "tetromino.hpp"
+#include "thread_pool.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace tetris {
+
+// Many AI-played games stored field by field. The boards of all games sit
+// in one array, and the pieces, positions, scores and piece generators each
+// sit in another, so stepping the batch walks memory in order instead of
+// chasing one heap object per game. step() moves every game one piece
+// forward in lockstep.
+//
+// Each game is its own task on the thread pool, so threads that run out of
+// games steal the others' and games that end early leave no thread idle.
+// Each thread has one AI, picked by its worker index, so the search scratch
+// and transposition table stay warm in the thread's cache instead of being
+// repeated per game. The table only caches what a position is worth, so
+// which AI searches a game never changes its moves.
+//
+// Game i is seeded with getSeed(i), which is gameSeed(seed, i), and plays
+// exactly like a Game with that seed and preview size whose moves come from
+// AI::findBestMove.
+class GameBatch {
+  public:
+    GameBatch(int num_games, std::uint64_t seed,
+              RandomizerKind kind = RandomizerKind::UNIFORM,
+              int preview_size = DEFAULT_PREVIEW_SIZE);
+
+    // Lock one piece in every active game. The result does not depend on the
+    // thread count.
+    void step();
+    // Start every game over. Piece streams carry on as with Game::reset().
+    void reset();
+
+    // Threads used by step(), counting the caller. 0, the default, uses
+    // every core.
+    void setThreads(int threads);
+    int getThreads() const { return pool_->getNumThreads(); }
+    // The batch already runs games in parallel, so config.threads is ignored
+    void setSearchConfig(const AI::SearchConfig &config);
+    void setWeights(const EvalWeights &weights);
+    // Games stop after locking this many pieces, 0 lets them play to the end
+    void setPieceLimit(int pieces) { piece_limit_ = pieces; }
+
+    int getNumGames() const { return num_games_; }
+    int getPreviewSize() const { return preview_size_; }
+    // Still playing and under the piece limit
+    bool isActive(int game) const;
+    int getActiveGames() const;
+
+    std::uint64_t getSeed(int game) const;
+    const Board &getBoard(int game) const { return boards_[index(game)]; }
+    const Tetromino &getCurrentPiece(int game) const { return pieces_[index(game)]; }
+    Position getCurrentPosition(int game) const { return positions_[index(game)]; }
+    // Index 0 spawns next
+    TetrominoType getPreview(int game, int i) const {
+        return previews_[index(game)][static_cast<std::size_t>(i)];
+    }
+    int getScore(int game) const { return scores_[index(game)]; }
+    int getLevel(int game) const { return levels_[index(game)]; }
+    int getLinesCleared(int game) const { return lines_[index(game)]; }
+    // Pieces locked since the game started
+    int getPieceCount(int game) const { return piece_counts_[index(game)]; }
+    GameState getState(int game) const { return states_[index(game)]; }
+    void captureSnapshot(int game, GameSnapshot &snapshot) const;
+
+    // Bytes of state kept for each game. The AIs, one per thread, come on top.
+    static std::size_t getBytesPerGame();
+    // Everything the batch holds, the AIs and their tables included
+    std::size_t getMemoryUsage() const;
+
+  private:
+    using Preview = std::array<TetrominoType, MAX_PREVIEW_SIZE>;
+
+    int num_games_;
+    std::uint64_t seed_;
+    int preview_size_;
+    int piece_limit_;
+    AI::SearchConfig search_;
+    EvalWeights weights_;
+    std::unique_ptr<ThreadPool> pool_;
+    std::vector<std::unique_ptr<AI>> ais_;
+
+    // One entry per game
+    std::vector<Board> boards_;
+    std::vector<Tetromino> pieces_;
+    std::vector<Position> positions_;
+    std::vector<Preview> previews_;
+    std::vector<Randomizer> randomizers_;
+    std::vector<int> scores_;
+    std::vector<int> levels_;
+    std::vector<int> lines_;
+    std::vector<int> piece_counts_;
+    std::vector<GameState> states_;
+
+    static std::size_t index(int game) { return static_cast<std::size_t>(game); }
+    void makeAIs();
+    void makeAIMove(AI &ai, std::size_t game);
+    void spawnNewPiece(std::size_t game);
+    void lockPiece(std::size_t game);
+};
+
+} // namespace tetris
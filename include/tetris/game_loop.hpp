@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <type_traits>
+
+namespace tetris {
+
+// Paces the simulation thread. Simulated time advances in whole steps of
+// step / speed regardless of how often advance() is called, so the game
+// runs at the same rate whatever the frame rate, and a late poll runs the
+// missed steps.
+class FixedTimestep {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // Steps handed out per advance() when running as fast as possible
+    static constexpr int UNLIMITED_BATCH = 64;
+    // A stall longer than this many steps is dropped rather than replayed
+    // in one burst
+    static constexpr int MAX_CATCH_UP = 8;
+
+    // speed multiplies the step rate, 0 or less runs as fast as possible
+    FixedTimestep(Clock::duration step, double speed, Clock::time_point start);
+
+    void setSpeed(double speed, Clock::time_point now);
+    double getSpeed() const { return speed_; }
+    bool isUnlimited() const { return speed_ <= 0.0; }
+
+    // Number of steps to run now
+    int advance(Clock::time_point now);
+    // When the next step falls due, meaningless when unlimited
+    Clock::time_point nextStepTime() const { return next_; }
+
+  private:
+    Clock::duration step_;
+    double speed_;
+    Clock::duration scaled_step_;
+    Clock::time_point next_;
+};
+
+// Lock-free hand-off of the latest value from one writer thread to one
+// reader thread. Three slots rotate between the writer's back buffer, a
+// shared middle slot and the reader's front buffer, swapped with a single
+// atomic exchange, so neither side ever waits for the other. Values the
+// reader misses are overwritten, never queued.
+template <typename T> class TripleBuffer {
+    static_assert(std::is_trivially_copyable_v<T>, "slots are handed over as raw memory");
+
+  public:
+    TripleBuffer() = default;
+    explicit TripleBuffer(const T &initial) { slots_.fill(initial); }
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    // Writer side: fill writeSlot(), then publish() it
+    T &writeSlot() { return slots_[back_]; }
+    void publish() {
+        unsigned previous = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel);
+        back_ = previous & INDEX_MASK;
+    }
+    void publish(const T &value) {
+        writeSlot() = value;
+        publish();
+    }
+
+    // Reader side: take the newest published value if there is one. read()
+    // stays valid and unchanged until the next fetch().
+    bool fetch() {
+        if ((middle_.load(std::memory_order_relaxed) & FRESH) == 0) {
+            return false;
+        }
+        unsigned previous = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = previous & INDEX_MASK;
+        return true;
+    }
+    const T &read() const { return slots_[front_]; }
+
+  private:
+    static constexpr unsigned INDEX_MASK = 3;
+    // Set in middle_ when it holds a value the reader has not taken
+    static constexpr unsigned FRESH = 4;
+
+    std::array<T, 3> slots_{};
+    // Each index lives on its own cache line, only middle_ is shared
+    alignas(64) std::atomic<unsigned> middle_{1};
+    alignas(64) unsigned back_ = 0;
+    alignas(64) unsigned front_ = 2;
+};
+
+} // namespace tetris
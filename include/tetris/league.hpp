@@ -0,0 +1,67 @@
+#pragma once
+
+#include "game.hpp"
+#include "multiplayer.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace tetris {
+
+// Most boards one frame of the multi-player screen can show
+constexpr int MAX_PAGE_BOARDS = 32;
+// Players listed on the leaderboard
+constexpr int LEADERBOARD_SIZE = 10;
+
+// How the boards on screen are chosen
+enum class PageOrder : std::uint8_t { RANK, PLAYER };
+
+// The page of boards the screen wants: size boards starting at rank or
+// player index first
+struct PageRequest {
+    PageOrder order = PageOrder::RANK;
+    int first = 0;
+    int size = 0;
+};
+
+struct PlayerStanding {
+    int player;
+    int score;
+    int lines;
+    int level;
+    GameState state;
+};
+
+// One frame of the multi-player screen as plain data: the leaderboard,
+// totals over every player and snapshots of the boards on the page
+struct LeagueFrame {
+    int num_players;
+    int active_players;
+    std::int64_t total_lines;
+    // The request the page was captured for, with first clamped to the
+    // players that exist
+    PageRequest page;
+    int num_leaders;
+    std::array<PlayerStanding, LEADERBOARD_SIZE> leaders;
+    int num_boards;
+    // Rank of each board's player, counted from 0. Only known in rank
+    // order, -1 otherwise.
+    std::array<int, MAX_PAGE_BOARDS> board_ranks;
+    std::array<int, MAX_PAGE_BOARDS> board_players;
+    std::array<GameSnapshot, MAX_PAGE_BOARDS> boards;
+};
+
+// Ranks the players of a match and captures a LeagueFrame. Players off the
+// page cost a read of their counters, their boards are never copied.
+class LeagueView {
+  public:
+    void capture(const MultiPlayerGame &match, const PageRequest &page, LeagueFrame &frame);
+
+  private:
+    std::vector<PlayerStanding> standings_;
+};
+
+// Ranking order: higher score first, then more lines, then lower player index
+bool ranksAbove(const PlayerStanding &a, const PlayerStanding &b);
+
+} // namespace tetris
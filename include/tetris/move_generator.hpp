@@ -0,0 +1,105 @@
+#pragma once
+
+#include "board.hpp"
+#include "game.hpp"
+#include "tetromino.hpp"
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace tetris {
+
+// Finds every placement a piece can reach by moving left, right and down
+// and rotating with Game's wall kicks, including tucks and slides under
+// overhangs that a straight hard drop misses. States are flood-filled on
+// column masks, one per (rotation, row), of the narrowest word that holds
+// every column a piece can start in: 16 bits on the standard board.
+template <int Width, int Height>
+class BasicMoveGenerator {
+  public:
+    using Board = BasicBoard<Width, Height>;
+
+    struct Placement {
+        int rotation;
+        Position pos;
+    };
+
+    // Placements room is made for up front, so generate() does not allocate
+    // in practice. Pieces on real boards rarely have more than four per
+    // column, 40 on the standard board, which gets room for 128.
+    static constexpr int RESERVED_PLACEMENTS = NUM_ROTATIONS * (3 * Width + 2);
+
+    BasicMoveGenerator() { placements_.reserve(RESERVED_PLACEMENTS); }
+
+    // Distinct resting spots reachable from piece at pos. Spots that cover
+    // exactly the same cells are reported once. The result stays valid until
+    // the next call.
+    const std::vector<Placement> &generate(const Board &board, const Tetromino &piece,
+                                           Position pos);
+
+    // Shortest inputs from the last generate() start to placement, ending
+    // with DROP. Returns false if the placement is unreachable or the path
+    // does not fit in an InputPath.
+    bool findPath(const Placement &placement, InputPath &path);
+
+  private:
+    // Column masks are offset so x = -3 (a piece whose blocks start at local
+    // column 3) lands on bit 0
+    static constexpr int X_OFFSET = 3;
+    static_assert(Width + X_OFFSET <= 64, "Column masks are at most 64 bits wide");
+
+    using ColumnMask = RowMaskFor<Width + X_OFFSET>;
+    // Masks are worked on at least 32 bits wide, shifts never overflow then
+    using Word = std::common_type_t<std::uint32_t, ColumnMask>;
+    using RowMasks = std::array<ColumnMask, static_cast<std::size_t>(Height)>;
+
+    static constexpr int NUM_COLUMNS = static_cast<int>(sizeof(ColumnMask) * 8);
+    static constexpr auto NUM_STATES =
+        static_cast<std::size_t>(NUM_ROTATIONS * Height * NUM_COLUMNS);
+    static_assert(NUM_STATES <= 65536, "State ids are kept in std::uint16_t");
+
+    TetrominoType type_ = TetrominoType::I;
+    int start_rotation_ = 0;
+    Position start_pos_{0, 0};
+    // Columns where the piece fits, and where it was reached
+    std::array<RowMasks, NUM_ROTATIONS> fits_{};
+    std::array<RowMasks, NUM_ROTATIONS> reached_{};
+    std::vector<Placement> placements_;
+
+    // Breadth-first search scratch for findPath, states are numbered
+    // (rotation * Height + y) * NUM_COLUMNS + column
+    std::array<std::uint16_t, NUM_STATES> parent_{};
+    std::array<Input, NUM_STATES> via_{};
+    std::array<std::uint16_t, NUM_STATES> queue_{};
+    std::array<RowMasks, NUM_ROTATIONS> seen_{};
+
+    static std::uint16_t stateId(int rotation, int y, int column) {
+        return static_cast<std::uint16_t>((rotation * Height + y) * NUM_COLUMNS +
+                                          column);
+    }
+
+    bool fits(int rotation, int y, int column) const {
+        if (y >= Height || column < 0 || column >= NUM_COLUMNS) {
+            return false;
+        }
+        return (fits_[static_cast<std::size_t>(rotation)][static_cast<std::size_t>(y)] >>
+                column) & 1;
+    }
+    void computeFits(const Board &board);
+    void floodFill();
+    // The usual rotate, shift and drop inputs, if they end on placement.
+    // Most placements are found this way without a search.
+    bool directPath(const Placement &placement, InputPath &path) const;
+    // Where ROTATE leads from (rotation, y, column), or false if it is blocked
+    bool rotateTarget(int rotation, int y, int column, int &target_column) const;
+};
+
+#define TETRIS_DECLARE_MOVE_GENERATOR(W, H)                                            \
+    extern template class BasicMoveGenerator<W, H>;
+TETRIS_BOARD_SIZES(TETRIS_DECLARE_MOVE_GENERATOR)
+#undef TETRIS_DECLARE_MOVE_GENERATOR
+
+using MoveGenerator = BasicMoveGenerator<BOARD_WIDTH, BOARD_HEIGHT>;
+
+} // namespace tetris
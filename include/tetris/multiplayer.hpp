@@ -1,30 +1,36 @@
 #pragma once
 
-#include "ai.hpp"
-#include "game.hpp"
-#include <memory>
-#include <vector>
+#include "game_batch.hpp"
+#include <cstdint>
 
 namespace tetris {
 
 class MultiPlayerGame {
   public:
     explicit MultiPlayerGame(int num_players);
+    // Each player's piece stream is derived from seed, so two games with the
+    // same seed play out identically
+    MultiPlayerGame(int num_players, std::uint64_t seed);
 
+    // Advance every player by one piece. Players are stepped in parallel on
+    // the thread pool and update() returns once all of them are done, with
+    // the same result as updating them one after another.
     void update();
     void reset();
 
-    int getNumPlayers() const { return num_players_; }
-    const Game &getGame(int player_id) const { return *games_[player_id]; }
+    // Threads used by update(), counting the caller. 0, the default, uses
+    // every core and 1 updates the players serially.
+    void setThreads(int threads) { games_.setThreads(threads); }
+    int getThreads() const { return games_.getThreads(); }
+
+    int getNumPlayers() const { return games_.getNumGames(); }
+    // Every player's game, player i is game i of the batch
+    const GameBatch &getGames() const { return games_; }
     bool isAnyPlaying() const;
     int getActivePlayers() const;
 
   private:
-    int num_players_;
-    std::vector<std::unique_ptr<Game>> games_;
-    std::vector<std::unique_ptr<AI>> ais_;
-
-    void makeAIMove(int player_id);
+    GameBatch games_;
 };
 
 } // namespace tetris
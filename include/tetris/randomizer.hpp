@@ -0,0 +1,88 @@
+#pragma once
+
+#include "board.hpp"
+#include "tetromino.hpp"
+#include <array>
+#include <cstdint>
+
+namespace tetris {
+
+// xoshiro256** (Blackman and Vigna): 32 bytes of state, a few cycles per
+// number. The state is expanded from a 64-bit seed with splitmix64.
+class Xoshiro256 {
+  public:
+    explicit Xoshiro256(std::uint64_t seed) {
+        for (auto &word : state_) {
+            seed += 0x9E3779B97F4A7C15ULL;
+            word = mixBits(seed);
+        }
+    }
+
+    std::uint64_t next() {
+        std::uint64_t result = rotl(state_[1] * 5, 7) * 9;
+        std::uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotl(state_[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, bound) without modulo bias (Lemire's method)
+    std::uint32_t below(std::uint32_t bound) {
+        std::uint64_t product = (next() >> 32) * bound;
+        auto low = static_cast<std::uint32_t>(product);
+        if (low < bound) {
+            std::uint32_t threshold = (0u - bound) % bound;
+            while (low < threshold) {
+                product = (next() >> 32) * bound;
+                low = static_cast<std::uint32_t>(product);
+            }
+        }
+        return static_cast<std::uint32_t>(product >> 32);
+    }
+
+  private:
+    std::array<std::uint64_t, 4> state_;
+
+    static constexpr std::uint64_t rotl(std::uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+};
+
+// How the piece sequence is drawn. UNIFORM picks every piece independently,
+// BAG deals shuffled sets of all seven pieces.
+enum class RandomizerKind : std::uint8_t { UNIFORM, BAG };
+
+// Seeded piece source. Pieces are generated a block at a time so the hot
+// path is an array read; the same seed and kind always give the same
+// sequence.
+class Randomizer {
+  public:
+    // A whole number of bags, so bags never straddle blocks
+    static constexpr int BLOCK_SIZE = 8 * NUM_TETROMINO_TYPES;
+
+    explicit Randomizer(std::uint64_t seed, RandomizerKind kind = RandomizerKind::UNIFORM)
+        : rng_(seed), kind_(kind), block_{}, cursor_(BLOCK_SIZE) {}
+
+    TetrominoType next() {
+        if (cursor_ == BLOCK_SIZE) {
+            refill();
+        }
+        return block_[cursor_++];
+    }
+
+    RandomizerKind getKind() const { return kind_; }
+
+  private:
+    Xoshiro256 rng_;
+    RandomizerKind kind_;
+    std::array<TetrominoType, BLOCK_SIZE> block_;
+    std::uint8_t cursor_;
+
+    void refill();
+};
+
+} // namespace tetris
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "board.hpp"
+#include "game.hpp"
+#include "randomizer.hpp"
+#include "tetromino.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tetris {
+
+// Replay files hold one record per locked piece: a varint packing the
+// piece type, rotation, column and flags, then the row when it differs
+// from a straight drop and the input path when one was recorded. A
+// keyframe with the whole board goes in front of every
+// keyframe_interval-th piece, and after the last piece when the count is a
+// multiple of the interval. An index of keyframe offsets at the end makes
+// seeking constant time.
+constexpr int DEFAULT_KEYFRAME_INTERVAL = 64;
+
+// Records a game as it is played, see Game::setRecorder. The game must be
+// fresh from Game(seed, kind) so the file can be re-simulated from the
+// seed, and a reset() is not recorded.
+class ReplayRecorder {
+  public:
+    ReplayRecorder(std::uint64_t seed, RandomizerKind kind,
+                   int keyframe_interval = DEFAULT_KEYFRAME_INTERVAL);
+
+    // Called by the game when its current piece locks, before the piece
+    // goes into the board. path holds the inputs that steered it there,
+    // if it was steered with Game::applyPath.
+    void recordLock(const Game &game, const Input *path, int path_length);
+
+    // Write the recording, with the game's final score to verify against.
+    // The file is written next to path and renamed into place.
+    bool save(const std::string &path, const Game &game) const;
+
+    int getPieceCount() const { return pieces_; }
+    // Bytes of piece records and keyframes so far
+    std::size_t getStreamBytes() const { return stream_.size(); }
+
+  private:
+    std::uint64_t seed_;
+    RandomizerKind kind_;
+    int keyframe_interval_;
+    int pieces_;
+    std::vector<std::uint8_t> stream_;
+    // Offset of each keyframe from the start of the stream
+    std::vector<std::uint64_t> keyframes_;
+};
+
+// The game as it stood just before piece `piece` locked, and where that
+// piece went
+struct ReplayState {
+    Board board;
+    int piece;
+    int score;
+    int lines;
+    int level;
+    // Unset at the end of the replay
+    bool has_next;
+    Tetromino next{TetrominoType::I};
+    Position next_pos;
+    // Empty unless the inputs were recorded
+    InputPath next_path;
+};
+
+struct ReplayCheck {
+    bool ok;
+    // Pieces re-simulated before the first mismatch, or all of them
+    int pieces;
+    int score;
+    int lines;
+};
+
+// A replay file mapped into memory for playback
+class ReplayFile {
+  public:
+    ReplayFile() = default;
+    ~ReplayFile();
+
+    ReplayFile(const ReplayFile &) = delete;
+    ReplayFile &operator=(const ReplayFile &) = delete;
+
+    // False if the file cannot be mapped or is not a replay
+    bool open(const std::string &path);
+    void close();
+
+    std::uint64_t getSeed() const { return seed_; }
+    RandomizerKind getRandomizerKind() const { return kind_; }
+    int getKeyframeInterval() const { return keyframe_interval_; }
+    int getPieceCount() const { return pieces_; }
+    int getRecordedScore() const { return score_; }
+    int getRecordedLines() const { return lines_; }
+    std::size_t getFileSize() const { return size_; }
+
+    // Restore the game before piece `piece` locks, getPieceCount() for the
+    // final board. Decodes from the nearest keyframe, so at most
+    // keyframe_interval - 1 pieces are replayed whatever the position.
+    bool seek(int piece, ReplayState &state) const;
+
+    // Re-simulate every piece from the seed and check that each one fits
+    // where it was recorded, that every keyframe matches and that the
+    // final score and lines are the recorded ones
+    ReplayCheck verify() const;
+
+  private:
+    const std::uint8_t *data_ = nullptr;
+    std::size_t size_ = 0;
+    std::uint64_t seed_ = 0;
+    RandomizerKind kind_ = RandomizerKind::UNIFORM;
+    int keyframe_interval_ = 0;
+    int pieces_ = 0;
+    int keyframes_ = 0;
+    int score_ = 0;
+    int lines_ = 0;
+    // Keyframe offsets, little-endian, straight from the mapping
+    const std::uint8_t *index_ = nullptr;
+
+    std::uint64_t keyframeOffset(int keyframe) const;
+};
+
+} // namespace tetris
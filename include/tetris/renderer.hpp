@@ -1,8 +1,12 @@
 #pragma once
 
 #include "game.hpp"
-#include "multiplayer.hpp"
+#include "league.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <ncurses.h>
+#include <string>
 #include <vector>
 
 namespace tetris {
@@ -14,36 +18,80 @@ struct LayoutInfo {
     int player_board_height;
 };
 
+// A board window and its info panel, with a shadow copy of what the
+// terminal currently shows in them. Frames only draw cells and lines that
+// differ from the shadow.
+struct PanelView {
+    // Shadow value that never matches a real cell, forcing a redraw
+    static constexpr std::uint8_t UNKNOWN_CELL = 0xFF;
+
+    WINDOW *game_win = nullptr;
+    WINDOW *info_win = nullptr;
+    int info_width = 0;
+    // Color of each visible cell, row-major from the top visible row
+    std::array<std::uint8_t, BOARD_WIDTH * BOARD_HEIGHT> cells{};
+    // Text of each info panel row
+    std::vector<std::string> info_lines;
+    // Borders and cells have to be drawn from scratch
+    bool stale = true;
+    bool showing_game_over = false;
+};
+
 class Renderer {
   public:
     Renderer();
     ~Renderer();
 
     void init();
-    void render(const Game &game);
-    void renderGameOver(const Game &game);
-    void renderMultiPlayer(const MultiPlayerGame &mp_game);
+    // Frames are drawn from snapshots, so the renderer never touches a
+    // Game the simulation thread may be changing
+    void render(const GameSnapshot &game);
+    void renderGameOver(const GameSnapshot &game);
+    // Draws the page of boards in the frame next to the leaderboard. Only
+    // windows for the page exist, however many players there are.
+    void renderMultiPlayer(const LeagueFrame &frame);
+    // Boards that fit on one page at the current terminal size
+    int getPageCapacity() const;
     void cleanup();
 
+    // Characters the last frame changed on screen: board cells and text
+    // columns that differ from the shadow copy, plus borders when a window
+    // is drawn from scratch. Terminal control sequences for cursor moves and
+    // colors come on top.
+    std::size_t getLastFrameBytes() const { return last_frame_bytes_; }
+
   private:
-    WINDOW *game_win_;
-    WINDOW *info_win_;
+    PanelView single_view_;
     int board_height_;
     int board_width_;
     int term_height_;
     int term_width_;
-    int last_num_players_;
+    int last_num_boards_;
     LayoutInfo cached_layout_;
-    std::vector<WINDOW *> mp_game_wins_;
-    std::vector<WINDOW *> mp_info_wins_;
+    std::vector<PanelView> mp_views_;
+    // Only its info window is used
+    PanelView leaderboard_view_;
+    std::array<std::string, 3> status_lines_;
+
+    bool active_;
+    std::size_t frame_bytes_;
+    std::size_t last_frame_bytes_;
 
     void drawBorder(WINDOW *win, int height, int width);
     void drawBlock(WINDOW *win, int x, int y, int color);
-    void renderSingleGame(WINDOW *game_win, WINDOW *info_win, const Game &game,
-                          int player_id);
+    void drawBoard(PanelView &view, const GameSnapshot &game, bool show_piece);
+    void drawInfoLine(PanelView &view, int row, int col, const std::string &text);
+    void drawStatusLine(std::size_t index, int y, const std::string &text);
+    void prepareView(PanelView &view);
+    // rank is -1 when not known
+    void renderSingleGame(PanelView &view, const GameSnapshot &game, int player_id, int rank);
+    void renderLeaderboard(const LeagueFrame &frame);
+    // Push every window to the terminal in one update
+    void finishFrame();
     void updateTerminalSize();
-    void recreateMultiPlayerWindows(int num_players);
-    LayoutInfo calculateLayout(int num_players) const;
+    void destroyMultiPlayerWindows();
+    void recreateMultiPlayerWindows(int num_boards);
+    LayoutInfo calculateLayout(int num_boards) const;
 };
 
 } // namespace tetris
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ai.hpp"
+#include "game.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tetris {
+
+// Headless AI games, played back to back without rendering or frame delays
+struct SimulationConfig {
+    int games = 100;
+    // Stop a game after this many pieces, 0 plays until it tops out
+    int piece_cap = 0;
+    // Game i is seeded with gameSeed(seed, i), so runs are reproducible
+    std::uint64_t seed = 1;
+    // Worker threads counting the caller, 0 uses every core
+    int threads = 0;
+    int preview_size = DEFAULT_PREVIEW_SIZE;
+    RandomizerKind randomizer = RandomizerKind::UNIFORM;
+    AI::SearchConfig search;
+    EvalWeights weights;
+    // One of BOARD_SIZES. Only the standard board plays as a GameBatch,
+    // games on other sizes are played one by one, side by side.
+    int board_width = BOARD_WIDTH;
+    int board_height = BOARD_HEIGHT;
+};
+
+struct GameResult {
+    std::uint64_t seed;
+    int score;
+    int lines;
+    int pieces;
+    // False when the game was stopped by the piece cap
+    bool topped_out;
+};
+
+// Percentiles use the nearest-rank method
+struct Distribution {
+    double mean;
+    int min;
+    int p50;
+    int p90;
+    int p99;
+    int max;
+};
+
+struct SimulationSummary {
+    int games;
+    std::int64_t pieces;
+    int topped_out;
+    Distribution score;
+    Distribution lines;
+};
+
+std::uint64_t gameSeed(std::uint64_t seed, int game_index);
+
+// Let the AI place pieces until the game ends or piece_cap pieces are down
+GameResult playGame(std::uint64_t seed, const SimulationConfig &config);
+
+// Play config.games games on config.threads threads, on the standard board
+// in lockstep as one GameBatch. Results are in game order, do not depend on
+// the thread count and match playGame() game for game.
+std::vector<GameResult> runSimulation(const SimulationConfig &config);
+
+// Bytes of game state runSimulation() keeps for each game
+std::size_t getBytesPerGame(const SimulationConfig &config);
+
+SimulationSummary summarize(const std::vector<GameResult> &results);
+
+} // namespace tetris
@@ -1,34 +1,213 @@
 #pragma once
 
 #include <array>
-#include <vector>
+#include <cstdint>
 
 namespace tetris {
 
-enum class TetrominoType { I, O, T, S, Z, J, L };
+enum class TetrominoType : std::uint8_t { I, O, T, S, Z, J, L };
+
+constexpr int NUM_TETROMINO_TYPES = 7;
+constexpr int NUM_ROTATIONS = 4;
+constexpr int BLOCKS_PER_PIECE = 4;
 
 struct Position {
     int x;
     int y;
 };
 
+using BlockList = std::array<Position, BLOCKS_PER_PIECE>;
+
+// Block offsets of each rotation, specialized per piece type below
+template <TetrominoType Type>
+struct TetrominoShapes;
+
+template <>
+struct TetrominoShapes<TetrominoType::I> {
+    static constexpr std::array<BlockList, NUM_ROTATIONS> rotations = {{
+        {{{0, 0}, {1, 0}, {2, 0}, {3, 0}}},
+        {{{0, 0}, {0, 1}, {0, 2}, {0, 3}}},
+        {{{0, 0}, {1, 0}, {2, 0}, {3, 0}}},
+        {{{0, 0}, {0, 1}, {0, 2}, {0, 3}}},
+    }};
+};
+
+template <>
+struct TetrominoShapes<TetrominoType::O> {
+    static constexpr std::array<BlockList, NUM_ROTATIONS> rotations = {{
+        {{{0, 0}, {1, 0}, {0, 1}, {1, 1}}},
+        {{{0, 0}, {1, 0}, {0, 1}, {1, 1}}},
+        {{{0, 0}, {1, 0}, {0, 1}, {1, 1}}},
+        {{{0, 0}, {1, 0}, {0, 1}, {1, 1}}},
+    }};
+};
+
+template <>
+struct TetrominoShapes<TetrominoType::T> {
+    static constexpr std::array<BlockList, NUM_ROTATIONS> rotations = {{
+        {{{1, 0}, {0, 1}, {1, 1}, {2, 1}}},
+        {{{1, 0}, {1, 1}, {2, 1}, {1, 2}}},
+        {{{0, 1}, {1, 1}, {2, 1}, {1, 2}}},
+        {{{1, 0}, {0, 1}, {1, 1}, {1, 2}}},
+    }};
+};
+
+template <>
+struct TetrominoShapes<TetrominoType::S> {
+    static constexpr std::array<BlockList, NUM_ROTATIONS> rotations = {{
+        {{{1, 0}, {2, 0}, {0, 1}, {1, 1}}},
+        {{{1, 0}, {1, 1}, {2, 1}, {2, 2}}},
+        {{{1, 0}, {2, 0}, {0, 1}, {1, 1}}},
+        {{{1, 0}, {1, 1}, {2, 1}, {2, 2}}},
+    }};
+};
+
+template <>
+struct TetrominoShapes<TetrominoType::Z> {
+    static constexpr std::array<BlockList, NUM_ROTATIONS> rotations = {{
+        {{{0, 0}, {1, 0}, {1, 1}, {2, 1}}},
+        {{{2, 0}, {1, 1}, {2, 1}, {1, 2}}},
+        {{{0, 0}, {1, 0}, {1, 1}, {2, 1}}},
+        {{{2, 0}, {1, 1}, {2, 1}, {1, 2}}},
+    }};
+};
+
+template <>
+struct TetrominoShapes<TetrominoType::J> {
+    static constexpr std::array<BlockList, NUM_ROTATIONS> rotations = {{
+        {{{0, 0}, {0, 1}, {1, 1}, {2, 1}}},
+        {{{1, 0}, {2, 0}, {1, 1}, {1, 2}}},
+        {{{0, 1}, {1, 1}, {2, 1}, {2, 2}}},
+        {{{1, 0}, {1, 1}, {0, 2}, {1, 2}}},
+    }};
+};
+
+template <>
+struct TetrominoShapes<TetrominoType::L> {
+    static constexpr std::array<BlockList, NUM_ROTATIONS> rotations = {{
+        {{{2, 0}, {0, 1}, {1, 1}, {2, 1}}},
+        {{{1, 0}, {1, 1}, {1, 2}, {2, 2}}},
+        {{{0, 1}, {1, 1}, {2, 1}, {0, 2}}},
+        {{{0, 0}, {1, 0}, {1, 1}, {1, 2}}},
+    }};
+};
+
+// Everything collision checks need about one orientation, derived from the
+// block offsets at compile time. Local coordinates span a 4x4 box.
+struct ShapeInfo {
+    BlockList blocks;
+    // Occupied columns of each local row, bit i = column i
+    std::array<std::uint16_t, 4> row_masks;
+    // Bounding box of the occupied cells
+    int min_x;
+    int max_x;
+    int min_y;
+    int max_y;
+    // Lowest occupied row per column, -1 for empty columns
+    std::array<std::int8_t, 4> bottom;
+    // Leftmost and rightmost occupied column per row, -1 for empty rows
+    std::array<std::int8_t, 4> left;
+    std::array<std::int8_t, 4> right;
+    // Lowest rotation with exactly the same cells (O has one orientation,
+    // I, S and Z have two), so searches can skip duplicate orientations
+    int canonical_rotation;
+};
+
+namespace detail {
+
+constexpr ShapeInfo makeShapeInfo(const BlockList &blocks) {
+    ShapeInfo info{};
+    info.blocks = blocks;
+    info.min_x = info.min_y = 3;
+    info.max_x = info.max_y = 0;
+    for (std::size_t i = 0; i < 4; i++) {
+        info.bottom[i] = info.left[i] = info.right[i] = -1;
+    }
+    for (const Position &block : blocks) {
+        auto col = static_cast<std::size_t>(block.x);
+        auto row = static_cast<std::size_t>(block.y);
+        info.row_masks[row] = static_cast<std::uint16_t>(info.row_masks[row] |
+                                                          (1u << block.x));
+        info.min_x = block.x < info.min_x ? block.x : info.min_x;
+        info.max_x = block.x > info.max_x ? block.x : info.max_x;
+        info.min_y = block.y < info.min_y ? block.y : info.min_y;
+        info.max_y = block.y > info.max_y ? block.y : info.max_y;
+        if (block.y > info.bottom[col]) {
+            info.bottom[col] = static_cast<std::int8_t>(block.y);
+        }
+        if (info.left[row] < 0 || block.x < info.left[row]) {
+            info.left[row] = static_cast<std::int8_t>(block.x);
+        }
+        if (block.x > info.right[row]) {
+            info.right[row] = static_cast<std::int8_t>(block.x);
+        }
+    }
+    return info;
+}
+
+template <TetrominoType Type>
+constexpr std::array<ShapeInfo, NUM_ROTATIONS> makeRotationTable() {
+    std::array<ShapeInfo, NUM_ROTATIONS> table{};
+    for (std::size_t r = 0; r < NUM_ROTATIONS; r++) {
+        table[r] = makeShapeInfo(TetrominoShapes<Type>::rotations[r]);
+        table[r].canonical_rotation = static_cast<int>(r);
+        for (std::size_t prev = 0; prev < r; prev++) {
+            bool same = true;
+            for (std::size_t row = 0; row < 4; row++) {
+                same = same && table[prev].row_masks[row] == table[r].row_masks[row];
+            }
+            if (same) {
+                table[r].canonical_rotation = static_cast<int>(prev);
+                break;
+            }
+        }
+    }
+    return table;
+}
+
+} // namespace detail
+
+// All 7x4 orientations, indexed by [type][rotation]
+inline constexpr std::array<std::array<ShapeInfo, NUM_ROTATIONS>, NUM_TETROMINO_TYPES>
+    SHAPE_TABLE = {{
+        detail::makeRotationTable<TetrominoType::I>(),
+        detail::makeRotationTable<TetrominoType::O>(),
+        detail::makeRotationTable<TetrominoType::T>(),
+        detail::makeRotationTable<TetrominoType::S>(),
+        detail::makeRotationTable<TetrominoType::Z>(),
+        detail::makeRotationTable<TetrominoType::J>(),
+        detail::makeRotationTable<TetrominoType::L>(),
+    }};
+
+// A piece is just its type and rotation; all geometry lives in SHAPE_TABLE
 class Tetromino {
   public:
-    Tetromino(TetrominoType type);
+    constexpr Tetromino(TetrominoType type) : type_(type), rotation_(0) {}
+    constexpr Tetromino(TetrominoType type, int rotation)
+        : type_(type), rotation_(static_cast<std::uint8_t>(rotation % NUM_ROTATIONS)) {}
 
-    void rotate();
-    void rotateBack();
-    const std::vector<Position> &getBlocks() const { return blocks_; }
+    void rotate() { rotation_ = static_cast<std::uint8_t>((rotation_ + 1) % 4); }
+    void rotateBack() { rotation_ = static_cast<std::uint8_t>((rotation_ + 3) % 4); }
+    const BlockList &getBlocks() const { return getShape().blocks; }
     TetrominoType getType() const { return type_; }
     int getRotation() const { return rotation_; }
 
+    const ShapeInfo &getShape() const {
+        return SHAPE_TABLE[static_cast<std::size_t>(type_)][rotation_];
+    }
+
+    // Occupied columns of a local row (0-3) as a bitmask, bit i = column i
+    std::uint16_t getRowMask(int row) const {
+        return getShape().row_masks[static_cast<std::size_t>(row)];
+    }
+    int getMinX() const { return getShape().min_x; }
+    int getMaxX() const { return getShape().max_x; }
+    int getMinY() const { return getShape().min_y; }
+    int getMaxY() const { return getShape().max_y; }
+
   private:
     TetrominoType type_;
-    int rotation_;
-    std::vector<Position> blocks_;
-
-    void updateBlocks();
-    std::vector<Position> getShapeBlocks(int rotation) const;
+    std::uint8_t rotation_;
 };
 
 } // namespace tetris
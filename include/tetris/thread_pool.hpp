@@ -0,0 +1,90 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace tetris {
+
+// A fixed set of worker threads that run index ranges in parallel. The
+// threads are started once and parked between jobs, so a job costs a wake-up
+// rather than a thread launch. Each thread starts on its own slice of the
+// range and steals half of another thread's remaining slice when it runs
+// dry, so uneven tasks still spread across every core.
+class ThreadPool {
+  public:
+    // num_threads counts the calling thread, so 1 runs everything inline.
+    // 0 picks one thread per hardware core.
+    explicit ThreadPool(int num_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int getNumThreads() const { return static_cast<int>(workers_.size()) + 1; }
+
+    // Call task(i) for every i in [0, count) and return once all calls are
+    // done. The calling thread takes part. Calls made from inside a task run
+    // inline rather than deadlocking on the busy workers.
+    template <typename Task> void parallelFor(int count, Task &&task) {
+        using TaskType = std::remove_reference_t<Task>;
+        run(
+            count,
+            [](void *context, int, int index) {
+                (*static_cast<TaskType *>(context))(index);
+            },
+            const_cast<void *>(static_cast<const void *>(&task)));
+    }
+
+    // Like parallelFor, but call task(worker, i), where worker in
+    // [0, getNumThreads()) is the thread making the call. Calls with the same
+    // worker never overlap, so tasks can share per-thread state indexed by it.
+    template <typename Task> void parallelForWorkers(int count, Task &&task) {
+        using TaskType = std::remove_reference_t<Task>;
+        run(
+            count,
+            [](void *context, int worker, int index) {
+                (*static_cast<TaskType *>(context))(worker, index);
+            },
+            const_cast<void *>(static_cast<const void *>(&task)));
+    }
+
+  private:
+    using TaskFunction = void (*)(void *context, int worker, int index);
+
+    // The indices [begin, end) a thread still has to run. The owner takes
+    // from the front, thieves take from the back.
+    struct alignas(64) Slice {
+        std::mutex mutex;
+        int begin = 0;
+        int end = 0;
+    };
+
+    std::vector<std::thread> workers_;
+    // One per thread, the caller's first
+    std::unique_ptr<Slice[]> slices_;
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable work_done_;
+
+    // The current job, guarded by mutex_
+    TaskFunction function_;
+    void *context_;
+    int busy_workers_;
+    std::uint64_t generation_;
+    bool stopping_;
+
+    void run(int count, TaskFunction function, void *context);
+    void workerLoop(int self);
+    // Run indices of the current job, stealing once the own slice is empty,
+    // until no slice has any left
+    void work(int self, TaskFunction function, void *context);
+    bool popFront(int self, int &index);
+    bool steal(int self);
+};
+
+} // namespace tetris
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tetris {
+
+// Fixed-size cache of board evaluations keyed by Zobrist hash (mixed with
+// searchKey() for the lines cleared on the way). Only leaf scores are stored,
+// never search values, so a hit is exact whatever search filled the table.
+// Entries are grouped into 64-byte buckets so a probe touches a single
+// cache line.
+class TranspositionTable {
+  public:
+    struct Entry {
+        std::uint64_t key;
+        std::int32_t value;
+        std::uint8_t generation;
+        std::uint8_t used;
+    };
+
+    static constexpr int ENTRIES_PER_BUCKET = 4;
+
+    struct alignas(64) Bucket {
+        Entry entries[ENTRIES_PER_BUCKET];
+    };
+
+    struct Stats {
+        std::uint64_t probes;
+        std::uint64_t hits;
+        std::uint64_t stores;
+        // Stores that evicted a different key
+        std::uint64_t replacements;
+    };
+
+    // num_buckets is rounded up to a power of two, 0 disables the table
+    explicit TranspositionTable(int num_buckets);
+
+    bool enabled() const { return !buckets_.empty(); }
+    std::size_t getMemoryUsage() const { return buckets_.size() * sizeof(Bucket); }
+
+    // Finds key and writes its value
+    bool probe(std::uint64_t key, int &value);
+    void store(std::uint64_t key, int value);
+
+    // Start a new search. Older entries still hit, they are only evicted
+    // first when a bucket is full.
+    void nextGeneration();
+    void clear();
+
+    const Stats &getStats() const { return stats_; }
+    double getHitRate() const;
+    void resetStats() { stats_ = {}; }
+
+  private:
+    std::vector<Bucket> buckets_;
+    std::uint64_t mask_;
+    std::uint8_t generation_;
+    Stats stats_;
+
+    Bucket &bucketFor(std::uint64_t key) { return buckets_[key & mask_]; }
+};
+
+// Keys mixed into a board hash to tell apart values that also depend on
+// search state, such as lines already cleared on the way to that board
+std::uint64_t searchKey(int cleared_lines, int depth);
+
+} // namespace tetris
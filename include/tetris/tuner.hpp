@@ -0,0 +1,84 @@
+#pragma once
+
+#include "ai.hpp"
+#include "batch_eval.hpp"
+#include "randomizer.hpp"
+#include "thread_pool.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tetris {
+
+// Genetic search over evaluator weights. Every generation each candidate
+// plays the same seeded headless games, fitness is the mean game score.
+// Weight vectors are kept at unit length, only their direction matters to
+// the move choice.
+struct TunerConfig {
+    int population = 24;
+    // Games per candidate per generation, fresh seeds every generation
+    int games = 16;
+    // Pieces per game, 0 plays until it tops out
+    int piece_cap = 500;
+    std::uint64_t seed = 1;
+    // Worker threads counting the caller, 0 uses every core
+    int threads = 0;
+    // Best candidates carried over unchanged
+    int elite = 4;
+    // Candidates drawn for each tournament selection
+    int tournament = 3;
+    // Chance that a child gets one weight nudged by up to mutation_step
+    double mutation_rate = 0.2;
+    double mutation_step = 0.2;
+    int preview_size = DEFAULT_PREVIEW_SIZE;
+    RandomizerKind randomizer = RandomizerKind::UNIFORM;
+    AI::SearchConfig search;
+};
+
+struct TunedWeights {
+    EvalWeights weights;
+    double fitness;
+};
+
+class Tuner {
+  public:
+    // The first population holds the default weights and random directions
+    explicit Tuner(const TunerConfig &config);
+
+    // Score the current population, then breed the next one
+    void runGeneration();
+
+    // Generations run so far, including ones run before a checkpoint
+    int getGeneration() const { return generation_; }
+    // The last scored population, best first, empty before the first
+    // generation. Elite candidates are scored again on every generation's
+    // games, so an old lucky score does not stick.
+    const std::vector<TunedWeights> &getScored() const { return scored_; }
+    // Candidates the next generation will score
+    const std::vector<EvalWeights> &getPopulation() const { return population_; }
+
+    // The run's state as text, written to a temporary file and renamed so an
+    // interrupted save keeps the previous checkpoint. Resuming from it gives
+    // exactly the generations an uninterrupted run would have.
+    bool saveCheckpoint(const std::string &path) const;
+    // Returns false, leaving the tuner as it was, if the file cannot be read
+    // or was written with a different seed, population or games count
+    bool loadCheckpoint(const std::string &path);
+
+  private:
+    TunerConfig config_;
+    ThreadPool pool_;
+    int generation_;
+    // Candidates for the next generation, not yet scored
+    std::vector<EvalWeights> population_;
+    std::vector<TunedWeights> scored_;
+    std::vector<int> game_scores_;
+
+    void breed(Xoshiro256 &rng);
+    const TunedWeights &select(Xoshiro256 &rng) const;
+};
+
+// Scale weights to unit length, leaving all-zero weights alone
+EvalWeights normalizeWeights(const EvalWeights &weights);
+
+} // namespace tetris
@@ -1,139 +1,381 @@
 #include <tetris/ai.hpp>
+#include <tetris/profiler.hpp>
+#include <algorithm>
+#include <array>
 #include <limits>
 
 namespace tetris {
 
-AI::AI() {}
+template <int Width, int Height>
+BasicAI<Width, Height>::BasicAI() : BasicAI(SearchConfig{}) {}
 
-int AI::calculateHeight(const Board &board) {
-    int total_height = 0;
-    for (int x = 0; x < board.getWidth(); x++) {
-        for (int y = 0; y < board.getHeight(); y++) {
-            if (board.getCell(x, y) != 0) {
-                total_height += board.getHeight() - y;
-                break;
-            }
-        }
+template <int Width, int Height>
+BasicAI<Width, Height>::BasicAI(const SearchConfig &config)
+    : config_(config), nodes_searched_(0), table_(config.table_buckets),
+      pool_(nullptr) {
+    if (config.threads != 1) {
+        own_pool_ = std::make_unique<ThreadPool>(config.threads);
+        pool_ = own_pool_.get();
+    }
+
+    // Beam searches keep up to beam_width nodes and score all of their
+    // children, parallel ones need a workspace per task
+    auto width = static_cast<std::size_t>(std::max(config.beam_width, 1));
+    std::size_t tasks = 0;
+    if (config.depth > 1) {
+        beam_.reserve(width);
+        next_beam_.reserve(width);
+        beam_keys_.reserve(width);
+        children_.reserve(width * MoveGenerator::RESERVED_PLACEMENTS);
+        child_candidates_.reserve(width * MoveGenerator::RESERVED_PLACEMENTS);
+        tasks = width;
+    }
+    if (pool_ != nullptr) {
+        auto threads = static_cast<std::size_t>(pool_->getNumThreads());
+        task_boards_.reserve(threads);
+        prepareTasks(std::max(tasks, threads));
     }
-    return total_height;
 }
 
-int AI::countHoles(const Board &board) {
-    int holes = 0;
-    for (int x = 0; x < board.getWidth(); x++) {
-        bool found_block = false;
-        for (int y = 0; y < board.getHeight(); y++) {
-            if (board.getCell(x, y) != 0) {
-                found_block = true;
-            } else if (found_block) {
-                holes++;
-            }
+template <int Width, int Height>
+BasicAI<Width, Height>::Workspace::Workspace() {
+    // Scores are padded to whole batch blocks
+    constexpr int RESERVED_SCORES =
+        MoveGenerator::RESERVED_PLACEMENTS + BatchEvaluator::LANES;
+    batch.reserve(MoveGenerator::RESERVED_PLACEMENTS);
+    candidates.reserve(MoveGenerator::RESERVED_PLACEMENTS);
+    scores.reserve(MoveGenerator::RESERVED_PLACEMENTS);
+    batch_scores.reserve(RESERVED_SCORES);
+}
+
+template <int Width, int Height>
+void BasicAI<Width, Height>::setThreadPool(ThreadPool *pool) {
+    pool_ = pool != nullptr ? pool : own_pool_.get();
+}
+
+template <int Width, int Height>
+void BasicAI<Width, Height>::setWeights(const EvalWeights &weights) {
+    weights_ = weights;
+    workspace_.batch.setWeights(weights);
+    for (Workspace &workspace : task_workspaces_) {
+        workspace.batch.setWeights(weights);
+    }
+    table_.clear();
+}
+
+template <int Width, int Height>
+void BasicAI<Width, Height>::prepareTasks(std::size_t count) {
+    std::size_t old_count = task_workspaces_.size();
+    if (old_count < count) {
+        task_workspaces_.resize(count);
+        for (std::size_t i = old_count; i < count; i++) {
+            task_workspaces_[i].batch.setWeights(weights_);
         }
     }
-    return holes;
 }
 
-int AI::calculateBumpiness(const Board &board) {
-    std::vector<int> heights(board.getWidth(), 0);
+template <int Width, int Height>
+int BasicAI<Width, Height>::calculateHeight(const Board &board) {
+    return board.getAggregateHeight();
+}
 
-    for (int x = 0; x < board.getWidth(); x++) {
-        for (int y = 0; y < board.getHeight(); y++) {
-            if (board.getCell(x, y) != 0) {
-                heights[x] = board.getHeight() - y;
-                break;
-            }
+template <int Width, int Height>
+int BasicAI<Width, Height>::countHoles(const Board &board) { return board.getHoles(); }
+
+template <int Width, int Height>
+int BasicAI<Width, Height>::calculateBumpiness(const Board &board) {
+    return board.getBumpiness();
+}
+
+template <int Width, int Height>
+int BasicAI<Width, Height>::countCompletedLines(const Board &board) {
+    return board.getFullRows();
+}
+
+template <int Width, int Height>
+int BasicAI<Width, Height>::evaluatePosition(const Board &board, const Tetromino &piece,
+                         Position pos) {
+    // Check if we can place the piece
+    if (!board.canPlace(piece, pos)) {
+        return std::numeric_limits<int>::min();
+    }
+
+    // Evaluate on a copy so the caller's board stays untouched
+    Board test_board = board;
+    return evaluatePlacement(test_board, piece, pos);
+}
+
+template <int Width, int Height>
+int BasicAI<Width, Height>::evaluatePlacement(Board &board, const Tetromino &piece,
+                                              Position pos) {
+    // Place the piece, score the result, then take it back
+    PlacementUndo undo = board.applyPlacement(piece, pos);
+    int score = scoreBoard(board, undo.lines_cleared);
+    board.undo(undo);
+    return score;
+}
+
+template <int Width, int Height>
+int BasicAI<Width, Height>::scoreBoard(const Board &board, int cleared_lines) {
+    return scoreFeatures(weights_, cleared_lines, calculateHeight(board), countHoles(board),
+                         calculateBumpiness(board));
+}
+
+template <int Width, int Height>
+void BasicAI<Width, Height>::scoreCandidates(Workspace &workspace, Board &board, TetrominoType type,
+                         const Placement *first, const Placement *last,
+                         int base_cleared_lines, TranspositionTable *table) {
+    // Gather the features of every candidate result board
+    workspace.candidates.clear();
+    workspace.scores.clear();
+    workspace.batch.clear();
+    std::uint64_t search_key = searchKey(base_cleared_lines, 0);
+
+    for (const Placement *placement = first; placement != last; placement++) {
+        Tetromino piece(type, placement->rotation);
+        std::uint64_t key = board.getHashAfterPlace(piece, placement->pos) ^ search_key;
+        int score = 0;
+        if (table != nullptr && table->probe(key, score)) {
+            workspace.candidates.push_back({placement->rotation, placement->pos, key, -1});
+            workspace.scores.push_back(score);
+            continue;
         }
+
+        PlacementUndo undo = board.applyPlacement(piece, placement->pos);
+        workspace.batch.add(board, base_cleared_lines + undo.lines_cleared);
+        board.undo(undo);
+        workspace.candidates.push_back(
+            {placement->rotation, placement->pos, key, workspace.batch.size() - 1});
+        workspace.scores.push_back(0);
     }
 
-    int bumpiness = 0;
-    for (int x = 0; x < board.getWidth() - 1; x++) {
-        bumpiness += std::abs(heights[x] - heights[x + 1]);
+    // Score the uncached ones all at once
+    workspace.batch.evaluate(workspace.batch_scores);
+    for (std::size_t i = 0; i < workspace.candidates.size(); i++) {
+        int batch_index = workspace.candidates[i].batch_index;
+        if (batch_index >= 0) {
+            workspace.scores[i] =
+                workspace.batch_scores[static_cast<std::size_t>(batch_index)];
+        }
     }
-    return bumpiness;
 }
 
-int AI::countCompletedLines(const Board &board) {
-    int completed = 0;
-    for (int y = 0; y < board.getHeight(); y++) {
-        bool is_full = true;
-        for (int x = 0; x < board.getWidth(); x++) {
-            if (board.getCell(x, y) == 0) {
-                is_full = false;
-                break;
-            }
-        }
-        if (is_full) {
-            completed++;
+template <int Width, int Height>
+void BasicAI<Width, Height>::storeScores(const Workspace &workspace) {
+    for (std::size_t i = 0; i < workspace.candidates.size(); i++) {
+        const Candidate &candidate = workspace.candidates[i];
+        if (candidate.batch_index >= 0) {
+            table_.store(candidate.key, workspace.scores[i]);
         }
     }
-    return completed;
+    nodes_searched_ += workspace.batch.size();
 }
 
-int AI::evaluatePosition(const Board &board, const Tetromino &piece,
-                         Position pos) {
-    // Create a copy of the board to test
-    Board test_board = board;
+template <int Width, int Height>
+auto BasicAI<Width, Height>::findBestMove(const Game &game) -> Move {
+    // The preview is a ring buffer inside the game, line it up
+    std::array<TetrominoType, MAX_PREVIEW_SIZE> preview;
+    for (int i = 0; i < game.getPreviewSize(); i++) {
+        preview[static_cast<std::size_t>(i)] = game.getPreview(i);
+    }
+    return findBestMove(SearchRoot{&game.getBoard(), game.getCurrentPiece(),
+                                   game.getCurrentPosition(), preview.data(),
+                                   game.getPreviewSize()});
+}
 
-    // Check if we can place the piece
-    if (!test_board.canPlace(piece, pos)) {
-        return std::numeric_limits<int>::min();
+template <int Width, int Height>
+auto BasicAI<Width, Height>::findBestMove(const SearchRoot &root) -> Move {
+    TETRIS_PROFILE_SCOPE(Probe::FIND_BEST_MOVE);
+    table_.nextGeneration();
+
+    // Look no further ahead than the preview queue allows
+    int depth = std::min(config_.depth, 1 + root.preview_size);
+    if (depth > 1 && config_.beam_width > 0) {
+        return findBestMoveBeam(root, depth);
     }
+    return findBestMoveGreedy(root);
+}
 
-    // Place the piece
-    test_board.place(piece, pos);
-    int cleared_lines = test_board.clearLines();
+template <int Width, int Height>
+auto BasicAI<Width, Height>::findBestMoveGreedy(const SearchRoot &root) -> Move {
+    const std::vector<Placement> &placements =
+        root_generator_.generate(*root.board, root.piece, root.pos);
+    TetrominoType type = root.piece.getType();
+    const Placement *begin = placements.data();
 
-    // Calculate heuristics
-    int height = calculateHeight(test_board);
-    int holes = countHoles(test_board);
-    int bumpiness = calculateBumpiness(test_board);
+    std::size_t num_parts = 1;
+    if (searchParallel() && !placements.empty()) {
+        // Equal runs of placements, each on its own copy of the board. Only
+        // the table lookups are skipped, the scores come out the same.
+        num_parts = static_cast<std::size_t>(pool_->getNumThreads());
+        prepareTasks(num_parts);
+        task_boards_.assign(num_parts, *root.board);
+        pool_->parallelFor(static_cast<int>(num_parts), [&](int part) {
+            auto task = static_cast<std::size_t>(part);
+            std::size_t first = placements.size() * task / num_parts;
+            std::size_t last = placements.size() * (task + 1) / num_parts;
+            scoreCandidates(task_workspaces_[task], task_boards_[task], type,
+                            begin + first, begin + last, 0, nullptr);
+        });
+    } else {
+        // One scratch copy per search, every candidate is applied and undone on it
+        Board board = *root.board;
+        scoreCandidates(workspace_, board, type, begin, begin + placements.size(), 0,
+                        &table_);
+    }
 
-    // Weights based on https://codemyroad.wordpress.com/2013/04/14/tetris-ai-the-near-perfect-player/
-    // These weights were found through genetic algorithm optimization
-    double score = 0.0;
-    score += cleared_lines * 0.760666;   // Reward line clears
-    score += height * (-0.510066);       // Penalize aggregate height
-    score += holes * (-0.35663);         // Penalize holes
-    score += bumpiness * (-0.184483);    // Penalize bumpiness
+    // Parts are visited in placement order, so the first of equally scored
+    // candidates wins whether or not the search ran in parallel
+    Move best_move{0, 0, 0, std::numeric_limits<int>::min(), {}};
+    for (std::size_t part = 0; part < num_parts; part++) {
+        const Workspace &workspace =
+            num_parts == 1 ? workspace_ : task_workspaces_[part];
+        storeScores(workspace);
+        for (std::size_t i = 0; i < workspace.candidates.size(); i++) {
+            if (workspace.scores[i] > best_move.score) {
+                const Candidate &candidate = workspace.candidates[i];
+                best_move = {candidate.rotation, candidate.pos.x, candidate.pos.y,
+                             workspace.scores[i], {}};
+            }
+        }
+    }
 
-    // Scale to integer for comparison (multiply by 1000 to maintain precision)
-    return static_cast<int>(score * 1000);
+    planPath(best_move);
+    return best_move;
 }
 
-AI::Move AI::findBestMove(const Game &game) {
-    const Board &board = game.getBoard();
-    const Tetromino &piece = game.getCurrentPiece();
+template <int Width, int Height>
+void BasicAI<Width, Height>::planPath(Move &move) {
+    if (move.score == std::numeric_limits<int>::min()) {
+        move.path.length = 0;
+        return;
+    }
+    // Only a path longer than InputPath holds can fail, drop in place then
+    if (!root_generator_.findPath({move.rotation, {move.x, move.y}}, move.path)) {
+        move.path.inputs[0] = Input::DROP;
+        move.path.length = 1;
+    }
+}
+
+template <int Width, int Height>
+auto BasicAI<Width, Height>::findBestMoveBeam(const SearchRoot &root, int depth) -> Move {
+    beam_.clear();
+    beam_.push_back({*root.board, {0, 0, 0, 0, {}}, 0, 0});
+    bool has_plan = false;
 
-    Move best_move{0, 0, std::numeric_limits<int>::min()};
+    for (int level = 0; level < depth; level++) {
+        Tetromino piece =
+            level == 0 ? root.piece
+                       : Tetromino(root.preview[static_cast<std::size_t>(level - 1)]);
 
-    // Try all rotations
-    for (int rotation = 0; rotation < 4; rotation++) {
-        Tetromino test_piece = piece;
-        for (int r = 0; r < rotation; r++) {
-            test_piece.rotate();
+        // The current piece starts where it is, later ones at the spawn point.
+        // The root's placements stay in root_generator_ for planPath.
+        auto expand = [&](Workspace &workspace, BeamNode &node, TranspositionTable *table) {
+            const std::vector<Placement> &placements =
+                level == 0 ? root_generator_.generate(node.board, piece, root.pos)
+                           : workspace.generator.generate(node.board, piece,
+                                                          Game::SPAWN_POSITION);
+            scoreCandidates(workspace, node.board, piece.getType(), placements.data(),
+                            placements.data() + placements.size(), node.cleared_lines,
+                            table);
+        };
+
+        // Score every expansion of every node in the beam. In parallel each
+        // node is a task and the results are gathered in node order, so the
+        // children line up exactly as in the serial search.
+        bool parallel = searchParallel() && beam_.size() > 1;
+        if (parallel) {
+            prepareTasks(beam_.size());
+            pool_->parallelFor(static_cast<int>(beam_.size()), [&](int n) {
+                auto task = static_cast<std::size_t>(n);
+                expand(task_workspaces_[task], beam_[task], nullptr);
+            });
+        }
+        children_.clear();
+        child_candidates_.clear();
+        for (std::size_t n = 0; n < beam_.size(); n++) {
+            BeamNode &node = beam_[n];
+            if (!parallel) {
+                expand(workspace_, node, &table_);
+            }
+            const Workspace &workspace = parallel ? task_workspaces_[n] : workspace_;
+            storeScores(workspace);
+            for (std::size_t i = 0; i < workspace.candidates.size(); i++) {
+                children_.push_back({static_cast<int>(n),
+                                     static_cast<int>(child_candidates_.size()),
+                                     workspace.scores[i]});
+                child_candidates_.push_back(workspace.candidates[i]);
+            }
         }
 
-        // Try all horizontal positions
-        for (int x = -3; x < board.getWidth() + 3; x++) {
-            // Drop to lowest position
-            Position test_pos{x, 0};
-            while (board.canPlace(test_piece, test_pos)) {
-                test_pos.y++;
+        // Keep the best beam_width distinct children. Ties go to the earlier
+        // child, which keeps the search deterministic. Sort some spares in
+        // case transpositions knock out a few of the best.
+        auto width = static_cast<std::size_t>(config_.beam_width);
+        std::size_t keep = std::min(children_.size(), 2 * width);
+        std::partial_sort(children_.begin(),
+                          children_.begin() + static_cast<std::ptrdiff_t>(keep),
+                          children_.end(), [](const Child &a, const Child &b) {
+                              if (a.score != b.score) {
+                                  return a.score > b.score;
+                              }
+                              return a.candidate < b.candidate;
+                          });
+
+        next_beam_.clear();
+        beam_keys_.clear();
+        for (std::size_t k = 0; k < keep && next_beam_.size() < width; k++) {
+            const Child &child = children_[k];
+            const BeamNode &parent = beam_[static_cast<std::size_t>(child.parent)];
+            const Candidate &candidate =
+                child_candidates_[static_cast<std::size_t>(child.candidate)];
+
+            Tetromino placed(piece.getType(), candidate.rotation);
+            BeamNode next{parent.board, parent.first_move, parent.cleared_lines,
+                          child.score};
+            next.cleared_lines += next.board.applyPlacement(placed, candidate.pos)
+                                      .lines_cleared;
+            // A board that tops out ends the game, never keep it
+            if (next.board.isGameOver()) {
+                continue;
             }
-            test_pos.y--; // Back up one
-
-            if (test_pos.y >= 0) {
-                int score = evaluatePosition(board, test_piece, test_pos);
-                if (score > best_move.score) {
-                    best_move.rotation = rotation;
-                    best_move.x = x;
-                    best_move.score = score;
-                }
+            // Other move orders may already have reached this board. The keys
+            // kept so far stay sorted, at most beam_width of them.
+            std::uint64_t key =
+                next.board.getHash() ^ searchKey(next.cleared_lines, level + 1);
+            auto slot = std::lower_bound(beam_keys_.begin(), beam_keys_.end(), key);
+            if (slot != beam_keys_.end() && *slot == key) {
+                continue;
             }
+            beam_keys_.insert(slot, key);
+            if (level == 0) {
+                next.first_move = {candidate.rotation, candidate.pos.x, candidate.pos.y,
+                                   child.score, {}};
+            }
+            next_beam_.push_back(next);
+        }
+
+        // Nothing survives this level, settle for the best plan so far
+        if (next_beam_.empty()) {
+            break;
         }
+        std::swap(beam_, next_beam_);
+        has_plan = true;
+    }
+
+    // Every first move tops out, fall back to the greedy choice
+    if (!has_plan) {
+        return findBestMoveGreedy(root);
     }
 
+    Move best_move = beam_.front().first_move;
+    best_move.score = beam_.front().score;
+    planPath(best_move);
     return best_move;
 }
 
+#define TETRIS_DEFINE_AI(W, H) template class BasicAI<W, H>;
+TETRIS_BOARD_SIZES(TETRIS_DEFINE_AI)
+#undef TETRIS_DEFINE_AI
+
 } // namespace tetris
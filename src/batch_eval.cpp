@@ -0,0 +1,224 @@
+#include <tetris/batch_eval.hpp>
+#include <cstdlib>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TETRIS_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define TETRIS_X86_SIMD 0
+#endif
+
+namespace tetris {
+
+namespace {
+
+template <int Width>
+using Block = typename BasicBatchEvaluator<Width>::Block;
+constexpr int LANES = BatchEvaluator::LANES;
+
+template <int Width>
+void evaluateScalar(const Block<Width> *blocks, std::size_t num_blocks,
+                    const EvalWeights &weights, int *out) {
+    for (std::size_t b = 0; b < num_blocks; b++) {
+        const Block<Width> &block = blocks[b];
+        for (int lane = 0; lane < LANES; lane++) {
+            int height = block.heights[0][lane];
+            int bumpiness = 0;
+            for (int x = 1; x < Width; x++) {
+                height += block.heights[x][lane];
+                bumpiness += std::abs(block.heights[x][lane] - block.heights[x - 1][lane]);
+            }
+            out[b * LANES + static_cast<std::size_t>(lane)] = scoreFeatures(
+                weights, block.cleared[lane], height, block.holes[lane], bumpiness);
+        }
+    }
+}
+
+#if TETRIS_X86_SIMD
+
+// Score four lanes whose features are in the low halves of the inputs. Same
+// operation order as scoreFeatures().
+__m128i scoreQuadSse2(const EvalWeights &weights, __m128i cleared, __m128i height,
+                      __m128i holes, __m128i bump) {
+    __m128i result[2];
+    for (int half = 0; half < 2; half++) {
+        __m128d score = _mm_mul_pd(_mm_cvtepi32_pd(cleared), _mm_set1_pd(weights.lines));
+        score = _mm_add_pd(score,
+                           _mm_mul_pd(_mm_cvtepi32_pd(height), _mm_set1_pd(weights.height)));
+        score = _mm_add_pd(score,
+                           _mm_mul_pd(_mm_cvtepi32_pd(holes), _mm_set1_pd(weights.holes)));
+        score = _mm_add_pd(score,
+                           _mm_mul_pd(_mm_cvtepi32_pd(bump), _mm_set1_pd(weights.bumpiness)));
+        result[half] = _mm_cvttpd_epi32(_mm_mul_pd(score, _mm_set1_pd(1000.0)));
+
+        cleared = _mm_shuffle_epi32(cleared, 0xEE);
+        height = _mm_shuffle_epi32(height, 0xEE);
+        holes = _mm_shuffle_epi32(holes, 0xEE);
+        bump = _mm_shuffle_epi32(bump, 0xEE);
+    }
+    return _mm_unpacklo_epi64(result[0], result[1]);
+}
+
+template <int Width>
+void evaluateSse2(const Block<Width> *blocks, std::size_t num_blocks,
+                  const EvalWeights &weights, int *out) {
+    for (std::size_t b = 0; b < num_blocks; b++) {
+        const Block<Width> &block = blocks[b];
+        for (int quad = 0; quad < LANES; quad += 4) {
+            auto load = [quad](const std::int32_t *lanes) {
+                return _mm_load_si128(reinterpret_cast<const __m128i *>(lanes + quad));
+            };
+
+            __m128i prev = load(block.heights[0]);
+            __m128i height = prev;
+            __m128i bump = _mm_setzero_si128();
+            for (int x = 1; x < Width; x++) {
+                __m128i cur = load(block.heights[x]);
+                height = _mm_add_epi32(height, cur);
+                // |d| = (d ^ sign) - sign, SSE2 has no abs instruction
+                __m128i diff = _mm_sub_epi32(cur, prev);
+                __m128i sign = _mm_srai_epi32(diff, 31);
+                bump = _mm_add_epi32(bump, _mm_sub_epi32(_mm_xor_si128(diff, sign), sign));
+                prev = cur;
+            }
+
+            __m128i scores =
+                scoreQuadSse2(weights, load(block.cleared), height, load(block.holes), bump);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + b * LANES + quad), scores);
+        }
+    }
+}
+
+__attribute__((target("avx2"))) __m128i scoreQuadAvx2(const EvalWeights &weights,
+                                                     __m128i cleared, __m128i height,
+                                                     __m128i holes, __m128i bump) {
+    __m256d score =
+        _mm256_mul_pd(_mm256_cvtepi32_pd(cleared), _mm256_set1_pd(weights.lines));
+    score = _mm256_add_pd(
+        score, _mm256_mul_pd(_mm256_cvtepi32_pd(height), _mm256_set1_pd(weights.height)));
+    score = _mm256_add_pd(
+        score, _mm256_mul_pd(_mm256_cvtepi32_pd(holes), _mm256_set1_pd(weights.holes)));
+    score = _mm256_add_pd(
+        score, _mm256_mul_pd(_mm256_cvtepi32_pd(bump), _mm256_set1_pd(weights.bumpiness)));
+    return _mm256_cvttpd_epi32(_mm256_mul_pd(score, _mm256_set1_pd(1000.0)));
+}
+
+template <int Width>
+__attribute__((target("avx2"))) void evaluateAvx2(const Block<Width> *blocks,
+                                                  std::size_t num_blocks,
+                                                  const EvalWeights &weights, int *out) {
+    for (std::size_t b = 0; b < num_blocks; b++) {
+        const Block<Width> &block = blocks[b];
+        const auto *heights = reinterpret_cast<const __m256i *>(block.heights);
+
+        __m256i prev = _mm256_load_si256(&heights[0]);
+        __m256i height = prev;
+        __m256i bump = _mm256_setzero_si256();
+        for (int x = 1; x < Width; x++) {
+            __m256i cur = _mm256_load_si256(&heights[x]);
+            height = _mm256_add_epi32(height, cur);
+            bump = _mm256_add_epi32(bump, _mm256_abs_epi32(_mm256_sub_epi32(cur, prev)));
+            prev = cur;
+        }
+
+        const auto *cleared_ptr = reinterpret_cast<const __m256i *>(block.cleared);
+        const auto *holes_ptr = reinterpret_cast<const __m256i *>(block.holes);
+        __m256i cleared = _mm256_load_si256(cleared_ptr);
+        __m256i holes = _mm256_load_si256(holes_ptr);
+        for (int half = 0; half < 2; half++) {
+            __m128i scores = half == 0
+                                 ? scoreQuadAvx2(weights, _mm256_castsi256_si128(cleared),
+                                                 _mm256_castsi256_si128(height),
+                                                 _mm256_castsi256_si128(holes),
+                                                 _mm256_castsi256_si128(bump))
+                                 : scoreQuadAvx2(weights, _mm256_extracti128_si256(cleared, 1),
+                                                 _mm256_extracti128_si256(height, 1),
+                                                 _mm256_extracti128_si256(holes, 1),
+                                                 _mm256_extracti128_si256(bump, 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + b * LANES + half * 4),
+                             scores);
+        }
+    }
+}
+
+#endif
+
+} // namespace
+
+SimdLevel detectSimdLevel() {
+#if TETRIS_X86_SIMD
+    static const SimdLevel level = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::SSE2;
+    }();
+    return level;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+template <int Width>
+template <int Height>
+void BasicBatchEvaluator<Width>::add(const BasicBoard<Width, Height> &board,
+                                     int cleared_lines) {
+    auto block_index = static_cast<std::size_t>(size_ / LANES);
+    int lane = size_ % LANES;
+    if (block_index == blocks_.size()) {
+        blocks_.emplace_back();
+    }
+    if (lane == 0) {
+        // Zero the block so unused lanes hold valid (empty board) features
+        blocks_[block_index] = Block{};
+    }
+
+    Block &block = blocks_[block_index];
+    const auto &heights = board.getColumnHeights();
+    for (std::size_t x = 0; x < Width; x++) {
+        block.heights[x][lane] = heights[x];
+    }
+    block.holes[lane] = board.getHoles();
+    block.cleared[lane] = cleared_lines;
+    size_++;
+}
+
+template <int Width>
+void BasicBatchEvaluator<Width>::evaluate(std::vector<int> &scores) const {
+    evaluate(scores, detectSimdLevel());
+}
+
+template <int Width>
+void BasicBatchEvaluator<Width>::evaluate(std::vector<int> &scores,
+                                          SimdLevel level) const {
+    // Never run a kernel the CPU cannot execute
+    if (level > detectSimdLevel()) {
+        level = detectSimdLevel();
+    }
+
+    std::size_t num_blocks = static_cast<std::size_t>((size_ + LANES - 1) / LANES);
+    // Kernels write whole blocks, trim the padding lanes afterwards
+    scores.resize(num_blocks * LANES);
+
+    switch (level) {
+#if TETRIS_X86_SIMD
+    case SimdLevel::AVX2:
+        evaluateAvx2<Width>(blocks_.data(), num_blocks, weights_, scores.data());
+        break;
+    case SimdLevel::SSE2:
+        evaluateSse2<Width>(blocks_.data(), num_blocks, weights_, scores.data());
+        break;
+#endif
+    default:
+        evaluateScalar<Width>(blocks_.data(), num_blocks, weights_, scores.data());
+        break;
+    }
+
+    scores.resize(static_cast<std::size_t>(size_));
+}
+
+#define TETRIS_DEFINE_BATCH_EVALUATOR(W, H)                                            \
+    template class BasicBatchEvaluator<W>;                                             \
+    template void BasicBatchEvaluator<W>::add(const BasicBoard<W, H> &, int);
+TETRIS_BOARD_SIZES(TETRIS_DEFINE_BATCH_EVALUATOR)
+#undef TETRIS_DEFINE_BATCH_EVALUATOR
+
+} // namespace tetris
@@ -1,86 +1,386 @@
 #include <tetris/board.hpp>
+#include <tetris/profiler.hpp>
 #include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <cstdlib>
 
 namespace tetris {
 
-Board::Board() { reset(); }
+namespace {
 
-void Board::reset() {
-    for (auto &row : grid_) {
-        row.fill(0);
+template <std::size_t Count>
+constexpr std::array<std::uint64_t, Count> makeZobristKeys() {
+    std::array<std::uint64_t, Count> keys{};
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        keys[i] = mixBits(i);
     }
+    return keys;
 }
 
-bool Board::canPlace(const Tetromino &piece, Position pos) const {
-    for (const auto &block : piece.getBlocks()) {
-        int x = pos.x + block.x;
-        int y = pos.y + block.y;
+template <int Width, int Height>
+constexpr auto ZOBRIST_KEYS = makeZobristKeys<static_cast<std::size_t>(Width * Height)>();
 
-        // Check boundaries
-        if (x < 0 || x >= BOARD_WIDTH || y < 0 || y >= BOARD_HEIGHT) {
-            return false;
+template <int Width, int Height>
+std::uint64_t cellKey(int x, int y) {
+    return ZOBRIST_KEYS<Width, Height>[static_cast<std::size_t>(y * Width + x)];
+}
+
+// Rows promoted to at least unsigned, so shifts never go through int
+template <typename RowMask>
+using RowWord = std::common_type_t<unsigned, RowMask>;
+
+// Move a piece row mask from local columns to board columns
+template <typename RowMask>
+RowMask shiftRow(std::uint16_t mask, int x) {
+    RowWord<RowMask> wide = mask;
+    return static_cast<RowMask>(x >= 0 ? wide << x : wide >> -x);
+}
+
+// Mask of column x alone
+template <typename RowMask>
+RowMask columnBit(int x) {
+    return static_cast<RowMask>(RowWord<RowMask>{1} << x);
+}
+
+} // namespace
+
+template <int Width, int Height>
+BasicBoard<Width, Height>::BasicBoard() { reset(); }
+
+template <int Width, int Height>
+void BasicBoard<Width, Height>::reset() {
+    rows_.fill(0);
+    for (auto &row : colors_) {
+        row.fill(0);
+    }
+    resetSlots();
+    heights_.fill(0);
+    aggregate_height_ = 0;
+    cell_count_ = 0;
+    full_rows_ = 0;
+    hash_ = 0;
+}
+
+template <int Width, int Height>
+void BasicBoard<Width, Height>::loadCells(const Cells &cells) {
+    colors_ = cells;
+    resetSlots();
+    cell_count_ = 0;
+    full_rows_ = 0;
+    for (int y = 0; y < Height; y++) {
+        auto row = static_cast<std::size_t>(y);
+        RowMask mask = 0;
+        for (int x = 0; x < Width; x++) {
+            if (cells[row][static_cast<std::size_t>(x)] != 0) {
+                mask = static_cast<RowMask>(mask | columnBit<RowMask>(x));
+            }
         }
+        rows_[row] = mask;
+        cell_count_ += static_cast<int>(std::bitset<sizeof(RowMask) * 8>(mask).count());
+        full_rows_ += mask == FULL_ROW_MASK ? 1 : 0;
+    }
+    recomputeHeights();
+    recomputeHash();
+}
+
+template <int Width, int Height>
+bool BasicBoard<Width, Height>::canPlace(const Tetromino &piece, Position pos) const {
+    const ShapeInfo &shape = piece.getShape();
 
-        // Check collision with existing blocks
-        if (grid_[y][x] != 0) {
+    // Check boundaries
+    if (pos.x + shape.min_x < 0 || pos.x + shape.max_x >= Width ||
+        pos.y + shape.min_y < 0 || pos.y + shape.max_y >= Height) {
+        return false;
+    }
+
+    // Check collision with existing blocks, one row at a time
+    for (int r = shape.min_y; r <= shape.max_y; r++) {
+        auto mask = shape.row_masks[static_cast<std::size_t>(r)];
+        if (getRow(pos.y + r) & shiftRow<RowMask>(mask, pos.x)) {
             return false;
         }
     }
     return true;
 }
 
-void Board::place(const Tetromino &piece, Position pos) {
-    int color = static_cast<int>(piece.getType()) + 1;
+template <int Width, int Height>
+void BasicBoard<Width, Height>::place(const Tetromino &piece, Position pos) {
+    auto color = static_cast<std::uint8_t>(static_cast<int>(piece.getType()) + 1);
     for (const auto &block : piece.getBlocks()) {
         int x = pos.x + block.x;
         int y = pos.y + block.y;
-        if (x >= 0 && x < BOARD_WIDTH && y >= 0 && y < BOARD_HEIGHT) {
-            grid_[y][x] = color;
+        if (x >= 0 && x < Width && y >= 0 && y < Height) {
+            auto row = static_cast<std::size_t>(y);
+            auto col = static_cast<std::size_t>(x);
+            colors_[row_slots_[row]][col] = color;
+            if (rows_[row] & columnBit<RowMask>(x)) {
+                continue;
+            }
+
+            rows_[row] = static_cast<RowMask>(rows_[row] | columnBit<RowMask>(x));
+            hash_ ^= cellKey<Width, Height>(x, y);
+            cell_count_++;
+            if (rows_[row] == FULL_ROW_MASK) {
+                full_rows_++;
+            }
+            int height = Height - y;
+            if (height > heights_[col]) {
+                aggregate_height_ += height - heights_[col];
+                heights_[col] = static_cast<std::uint8_t>(height);
+            }
         }
     }
 }
 
-int Board::clearLines() {
+template <int Width, int Height>
+int BasicBoard<Width, Height>::clearLines() {
+    TETRIS_PROFILE_SCOPE(Probe::CLEAR_LINES);
+    if (full_rows_ == 0) {
+        return 0;
+    }
+
+    // Find the full rows from the bottom up, stopping at the last one, then
+    // remove them top to bottom so the ones still to go keep their index
+    std::array<std::int8_t, static_cast<std::size_t>(Height)> full;
     int lines_cleared = 0;
+    for (int y = Height - 1; lines_cleared < full_rows_; y--) {
+        if (rows_[static_cast<std::size_t>(y)] == FULL_ROW_MASK) {
+            full[static_cast<std::size_t>(lines_cleared++)] = static_cast<std::int8_t>(y);
+        }
+    }
+    int lowest = full[0];
+    int highest = full[static_cast<std::size_t>(lines_cleared - 1)];
+
+    // Only the rows from the stack top down to the lowest full row change.
+    // Take their keys out of the hash and put the moved rows back in at
+    // their new index.
+    int top = getStackTop();
+    for (int y = top; y <= lowest; y++) {
+        hash_ ^= getRowHash(y);
+    }
+    int row_top = top;
+    for (int i = lines_cleared - 1; i >= 0; i--) {
+        row_top = removeRow(full[static_cast<std::size_t>(i)], row_top);
+    }
+    for (int y = row_top; y <= lowest; y++) {
+        hash_ ^= getRowHash(y);
+    }
 
-    for (int y = BOARD_HEIGHT - 1; y >= 0; y--) {
-        bool is_full = true;
-        for (int x = 0; x < BOARD_WIDTH; x++) {
-            if (grid_[y][x] == 0) {
-                is_full = false;
-                break;
+    // Columns topped above the highest full row sink by the lines cleared.
+    // The others had their top in that row, so walk down for their new one.
+    RowMask uncovered = 0;
+    for (int x = 0; x < Width; x++) {
+        auto col = static_cast<std::size_t>(x);
+        if (heights_[col] > Height - highest) {
+            heights_[col] = static_cast<std::uint8_t>(heights_[col] - lines_cleared);
+            aggregate_height_ -= lines_cleared;
+        } else {
+            aggregate_height_ -= heights_[col];
+            heights_[col] = 0;
+            uncovered = static_cast<RowMask>(uncovered | columnBit<RowMask>(x));
+        }
+    }
+    for (int y = highest + lines_cleared; y < Height && uncovered != 0; y++) {
+        RowWord<RowMask> found = getRow(y) & RowWord<RowMask>{uncovered};
+        uncovered = static_cast<RowMask>(uncovered & ~found);
+        for (int x = 0; found != 0; x++, found >>= 1) {
+            if (found & 1u) {
+                heights_[static_cast<std::size_t>(x)] =
+                    static_cast<std::uint8_t>(Height - y);
+                aggregate_height_ += Height - y;
             }
         }
+    }
 
-        if (is_full) {
-            lines_cleared++;
-            // Move all lines above down
-            for (int move_y = y; move_y > 0; move_y--) {
-                grid_[move_y] = grid_[move_y - 1];
+    cell_count_ -= lines_cleared * Width;
+    full_rows_ = 0;
+
+    return lines_cleared;
+}
+
+template <int Width, int Height>
+void BasicBoard<Width, Height>::recomputeHash() {
+    hash_ = 0;
+    for (int y = 0; y < Height; y++) {
+        hash_ ^= getRowHash(y);
+    }
+}
+
+template <int Width, int Height>
+std::uint64_t BasicBoard<Width, Height>::getRowHash(int y) const {
+    std::uint64_t hash = 0;
+    RowWord<RowMask> row = getRow(y);
+    for (int x = 0; row != 0; x++, row >>= 1) {
+        if (row & 1u) {
+            hash ^= cellKey<Width, Height>(x, y);
+        }
+    }
+    return hash;
+}
+
+template <int Width, int Height>
+int BasicBoard<Width, Height>::getStackTop() const {
+    return Height - *std::max_element(heights_.begin(), heights_.end());
+}
+
+template <int Width, int Height>
+std::uint64_t BasicBoard<Width, Height>::getHashAfterPlace(const Tetromino &piece,
+                                                          Position pos) const {
+    std::uint64_t hash = hash_;
+    for (const auto &block : piece.getBlocks()) {
+        hash ^= cellKey<Width, Height>(pos.x + block.x, pos.y + block.y);
+    }
+    return hash;
+}
+
+template <int Width, int Height>
+void BasicBoard<Width, Height>::recomputeHeights() {
+    heights_.fill(0);
+    aggregate_height_ = 0;
+
+    // Walk down from the top, the first block seen in a column is its top
+    RowMask seen = 0;
+    for (int y = 0; y < Height && seen != FULL_ROW_MASK; y++) {
+        RowWord<RowMask> top = getRow(y) & ~RowWord<RowMask>{seen} & FULL_ROW_MASK;
+        seen = static_cast<RowMask>(seen | top);
+        for (int x = 0; top != 0; x++, top >>= 1) {
+            if (top & 1u) {
+                heights_[static_cast<std::size_t>(x)] =
+                    static_cast<std::uint8_t>(Height - y);
+                aggregate_height_ += Height - y;
             }
-            grid_[0].fill(0);
-            y++; // Check this line again
         }
     }
+}
 
-    return lines_cleared;
+template <int Width, int Height>
+int BasicBoard<Width, Height>::getRowFill(int y) const {
+    return static_cast<int>(std::bitset<sizeof(RowMask) * 8>(getRow(y)).count());
 }
 
-bool Board::isGameOver() const {
-    // Check if top row has any blocks
-    for (int x = 0; x < BOARD_WIDTH; x++) {
-        if (grid_[0][x] != 0) {
-            return true;
+template <int Width, int Height>
+int BasicBoard<Width, Height>::getBumpiness() const {
+    int bumpiness = 0;
+    for (std::size_t x = 0; x + 1 < Width; x++) {
+        bumpiness += std::abs(heights_[x] - heights_[x + 1]);
+    }
+    return bumpiness;
+}
+
+template <int Width, int Height>
+auto BasicBoard<Width, Height>::applyPlacement(const Tetromino &piece, Position pos)
+    -> Undo {
+    // The record only saves rows in the piece's span, so rows that were
+    // already full would be cleared without a way back
+    assert(full_rows_ == 0 && "applyPlacement() needs a board without full rows");
+    Undo record{piece, pos, 0, {}, {}, hash_, heights_, aggregate_height_,
+                cell_count_, full_rows_};
+
+    place(piece, pos);
+
+    // Only rows the piece touched can have become full
+    if (full_rows_ > 0) {
+        const ShapeInfo &shape = piece.getShape();
+        for (int y = pos.y + shape.min_y; y <= pos.y + shape.max_y; y++) {
+            auto row = static_cast<std::size_t>(y);
+            if (rows_[row] == FULL_ROW_MASK) {
+                auto slot = static_cast<std::size_t>(record.lines_cleared++);
+                record.cleared_rows[slot] = static_cast<std::int8_t>(y);
+                record.cleared_colors[slot] = colors_[row_slots_[row]];
+            }
         }
+        clearLines();
     }
-    return false;
+
+    return record;
 }
 
-int Board::getCell(int x, int y) const {
-    if (x >= 0 && x < BOARD_WIDTH && y >= 0 && y < BOARD_HEIGHT) {
-        return grid_[y][x];
+template <int Width, int Height>
+void BasicBoard<Width, Height>::undo(const Undo &record) {
+    // Re-insert the cleared rows bottom to top, the reverse of clearLines().
+    // Each takes the slot of an empty row above the stack, so its colors are
+    // restored too.
+    int top = getStackTop();
+    for (int i = record.lines_cleared - 1; i >= 0; i--) {
+        auto slot = static_cast<std::size_t>(i);
+        auto row = static_cast<std::size_t>(record.cleared_rows[slot]);
+        top = insertRow(record.cleared_rows[slot], top);
+        colors_[row_slots_[row]] = record.cleared_colors[slot];
+    }
+
+    // Lift the piece back out. Its colors stay behind, masked by getCell().
+    for (const auto &block : record.piece.getBlocks()) {
+        int x = record.pos.x + block.x;
+        auto row = static_cast<std::size_t>(record.pos.y + block.y);
+        rows_[row] = static_cast<RowMask>(rows_[row] & ~columnBit<RowMask>(x));
+    }
+
+    hash_ = record.hash;
+    heights_ = record.heights;
+    aggregate_height_ = record.aggregate_height;
+    cell_count_ = record.cell_count;
+    full_rows_ = record.full_rows;
+}
+
+template <int Width, int Height>
+bool BasicBoard<Width, Height>::isGameOver() const {
+    // Check if top row has any blocks
+    return rows_[0] != 0;
+}
+
+template <int Width, int Height>
+int BasicBoard<Width, Height>::getCell(int x, int y) const {
+    if (x >= 0 && x < Width && y >= 0 && y < Height) {
+        auto row = static_cast<std::size_t>(y);
+        if (rows_[row] & columnBit<RowMask>(x)) {
+            return colors_[row_slots_[row]][static_cast<std::size_t>(x)];
+        }
     }
     return 0;
 }
 
+template <int Width, int Height>
+void BasicBoard<Width, Height>::resetSlots() {
+    for (std::size_t y = 0; y < row_slots_.size(); y++) {
+        row_slots_[y] = static_cast<std::uint8_t>(y);
+    }
+}
+
+template <int Width, int Height>
+int BasicBoard<Width, Height>::removeRow(int y, int top) {
+    auto row = static_cast<std::size_t>(y);
+    std::uint8_t slot = row_slots_[row];
+    std::copy_backward(rows_.begin() + top, rows_.begin() + y, rows_.begin() + y + 1);
+    std::copy_backward(row_slots_.begin() + top, row_slots_.begin() + y,
+                       row_slots_.begin() + y + 1);
+    rows_[static_cast<std::size_t>(top)] = 0;
+    row_slots_[static_cast<std::size_t>(top)] = slot;
+    return top + 1;
+}
+
+template <int Width, int Height>
+int BasicBoard<Width, Height>::insertRow(int y, int top) {
+    auto row = static_cast<std::size_t>(y);
+    if (top > y) {
+        // Nothing above y to move, and row y is empty
+        rows_[row] = FULL_ROW_MASK;
+        return y;
+    }
+
+    // The cleared rows left at least one empty row above the stack
+    assert(top > 0);
+    std::uint8_t slot = row_slots_[static_cast<std::size_t>(top - 1)];
+    std::copy(rows_.begin() + top, rows_.begin() + y + 1, rows_.begin() + top - 1);
+    std::copy(row_slots_.begin() + top, row_slots_.begin() + y + 1,
+              row_slots_.begin() + top - 1);
+    rows_[row] = FULL_ROW_MASK;
+    row_slots_[row] = slot;
+    return top - 1;
+}
+
+#define TETRIS_DEFINE_BOARD(W, H) template class BasicBoard<W, H>;
+TETRIS_BOARD_SIZES(TETRIS_DEFINE_BOARD)
+#undef TETRIS_DEFINE_BOARD
+
 } // namespace tetris
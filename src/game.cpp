@@ -1,16 +1,46 @@
 #include <tetris/game.hpp>
+#include <tetris/profiler.hpp>
+#include <tetris/recording.hpp>
+#include <algorithm>
 #include <chrono>
 
 namespace tetris {
 
-Game::Game()
-    : score_(0), level_(1), lines_cleared_(0), state_(GameState::PLAYING) {
-    auto seed = std::chrono::system_clock::now().time_since_epoch().count();
-    rng_.seed(seed);
+namespace {
+
+// Only standard games can be replayed, other sizes skip the recorder
+void recordLock(ReplayRecorder &recorder, const Game &game, const Input *inputs,
+                int count) {
+    recorder.recordLock(game, inputs, count);
+}
+
+template <int Width, int Height>
+void recordLock(ReplayRecorder &, const BasicGame<Width, Height> &, const Input *, int) {}
+
+} // namespace
+
+int lineClearScore(int lines, int level) {
+    // Score: 100 for 1 line, 300 for 2, 500 for 3, 800 for 4
+    static constexpr int POINTS[] = {0, 100, 300, 500, 800};
+    return POINTS[lines] * level;
+}
+
+template <int Width, int Height>
+BasicGame<Width, Height>::BasicGame()
+    : BasicGame(static_cast<std::uint64_t>(
+          std::chrono::system_clock::now().time_since_epoch().count())) {}
+
+template <int Width, int Height>
+BasicGame<Width, Height>::BasicGame(std::uint64_t seed, RandomizerKind randomizer)
+    : current_piece_(TetrominoType::I), score_(0), level_(1), lines_cleared_(0),
+      state_(GameState::PLAYING), randomizer_(seed, randomizer), queue_{},
+      queue_head_(0), queue_count_(0), preview_size_(DEFAULT_PREVIEW_SIZE), recorder_(nullptr),
+      path_(nullptr), path_begin_(0), path_end_(0) {
     spawnNewPiece();
 }
 
-void Game::reset() {
+template <int Width, int Height>
+void BasicGame<Width, Height>::reset() {
     board_.reset();
     score_ = 0;
     level_ = 1;
@@ -19,30 +49,65 @@ void Game::reset() {
     spawnNewPiece();
 }
 
-void Game::spawnNewPiece() {
-    std::uniform_int_distribution<int> dist(0, 6);
-    TetrominoType type = static_cast<TetrominoType>(dist(rng_));
-    current_piece_ = std::make_unique<Tetromino>(type);
-    current_pos_ = {BOARD_WIDTH / 2 - 1, 0};
+template <int Width, int Height>
+void BasicGame<Width, Height>::setPreviewSize(int size) {
+    preview_size_ = std::clamp(size, 0, MAX_PREVIEW_SIZE);
+    fillQueue();
+}
+
+template <int Width, int Height>
+TetrominoType BasicGame<Width, Height>::getPreview(int index) const {
+    return queue_[static_cast<std::size_t>((queue_head_ + index) % MAX_PREVIEW_SIZE)];
+}
+
+template <int Width, int Height>
+TetrominoType BasicGame<Width, Height>::randomPiece() { return randomizer_.next(); }
+
+template <int Width, int Height>
+void BasicGame<Width, Height>::fillQueue() {
+    while (queue_count_ < preview_size_) {
+        int tail = (queue_head_ + queue_count_) % MAX_PREVIEW_SIZE;
+        queue_[static_cast<std::size_t>(tail)] = randomPiece();
+        queue_count_++;
+    }
+}
+
+template <int Width, int Height>
+void BasicGame<Width, Height>::spawnNewPiece() {
+    TetrominoType type;
+    if (queue_count_ > 0) {
+        type = getPreview(0);
+        queue_head_ = (queue_head_ + 1) % MAX_PREVIEW_SIZE;
+        queue_count_--;
+    } else {
+        type = randomPiece();
+    }
+    fillQueue();
+
+    current_piece_ = Tetromino(type);
+    current_pos_ = SPAWN_POSITION;
 
-    if (!board_.canPlace(*current_piece_, current_pos_)) {
+    if (!board_.canPlace(current_piece_, current_pos_)) {
         state_ = GameState::GAME_OVER;
     }
 }
 
-void Game::moveLeft() {
+template <int Width, int Height>
+void BasicGame<Width, Height>::moveLeft() {
     if (state_ != GameState::PLAYING)
         return;
     tryMove(-1, 0);
 }
 
-void Game::moveRight() {
+template <int Width, int Height>
+void BasicGame<Width, Height>::moveRight() {
     if (state_ != GameState::PLAYING)
         return;
     tryMove(1, 0);
 }
 
-void Game::moveDown() {
+template <int Width, int Height>
+void BasicGame<Width, Height>::moveDown() {
     if (state_ != GameState::PLAYING)
         return;
     if (!tryMove(0, 1)) {
@@ -50,19 +115,21 @@ void Game::moveDown() {
     }
 }
 
-void Game::rotate() {
+template <int Width, int Height>
+void BasicGame<Width, Height>::rotate() {
     if (state_ != GameState::PLAYING)
         return;
-    current_piece_->rotate();
-    if (!board_.canPlace(*current_piece_, current_pos_)) {
+    current_piece_.rotate();
+    if (!board_.canPlace(current_piece_, current_pos_)) {
         // Try wall kick
         if (!tryMove(-1, 0) && !tryMove(1, 0)) {
-            current_piece_->rotateBack();
+            current_piece_.rotateBack();
         }
     }
 }
 
-void Game::drop() {
+template <int Width, int Height>
+void BasicGame<Width, Height>::drop() {
     if (state_ != GameState::PLAYING)
         return;
     while (tryMove(0, 1)) {
@@ -70,30 +137,105 @@ void Game::drop() {
     lockPiece();
 }
 
-void Game::update() {
+template <int Width, int Height>
+void BasicGame<Width, Height>::applyInput(Input input) {
+    switch (input) {
+    case Input::LEFT:
+        moveLeft();
+        break;
+    case Input::RIGHT:
+        moveRight();
+        break;
+    case Input::DOWN:
+        moveDown();
+        break;
+    case Input::ROTATE:
+        rotate();
+        break;
+    case Input::DROP:
+        drop();
+        break;
+    }
+}
+
+template <int Width, int Height>
+void BasicGame<Width, Height>::applyPath(const InputPath &path) {
+    path_ = &path;
+    path_begin_ = 0;
+    for (int i = 0; i < path.length; i++) {
+        path_end_ = i + 1;
+        applyInput(path.inputs[static_cast<std::size_t>(i)]);
+    }
+    path_ = nullptr;
+}
+
+template <int Width, int Height>
+bool BasicGame<Width, Height>::applyPlacement(int rotation, Position pos) {
+    if (state_ != GameState::PLAYING || rotation < 0 || rotation >= NUM_ROTATIONS)
+        return false;
+    Tetromino piece(current_piece_.getType(), rotation);
+    if (!board_.canPlace(piece, pos) || board_.canPlace(piece, {pos.x, pos.y + 1}))
+        return false;
+    current_piece_ = piece;
+    current_pos_ = pos;
+    lockPiece();
+    return true;
+}
+
+template <int Width, int Height>
+void BasicGame<Width, Height>::captureSnapshot(GameSnapshot &snapshot) const {
+    for (int y = 0; y < Height; y++) {
+        for (int x = 0; x < Width; x++) {
+            snapshot.cells[static_cast<std::size_t>(y)][static_cast<std::size_t>(x)] =
+                static_cast<std::uint8_t>(board_.getCell(x, y));
+        }
+    }
+    snapshot.piece = current_piece_.getType();
+    snapshot.rotation = static_cast<std::uint8_t>(current_piece_.getRotation());
+    snapshot.state = state_;
+    snapshot.pos = current_pos_;
+    snapshot.score = score_;
+    snapshot.level = level_;
+    snapshot.lines = lines_cleared_;
+}
+
+template <int Width, int Height>
+void BasicGame<Width, Height>::update() {
     if (state_ != GameState::PLAYING)
         return;
     moveDown();
 }
 
-bool Game::tryMove(int dx, int dy) {
+template <int Width, int Height>
+bool BasicGame<Width, Height>::tryMove(int dx, int dy) {
     Position new_pos = {current_pos_.x + dx, current_pos_.y + dy};
-    if (board_.canPlace(*current_piece_, new_pos)) {
+    if (board_.canPlace(current_piece_, new_pos)) {
         current_pos_ = new_pos;
         return true;
     }
     return false;
 }
 
-void Game::lockPiece() {
-    board_.place(*current_piece_, current_pos_);
+template <int Width, int Height>
+void BasicGame<Width, Height>::lockPiece() {
+    TETRIS_PROFILE_SCOPE(Probe::LOCK_PIECE);
+    if (recorder_ != nullptr) {
+        if (path_ != nullptr) {
+            recordLock(*recorder_, *this,
+                       &path_->inputs[static_cast<std::size_t>(path_begin_)],
+                       path_end_ - path_begin_);
+        } else {
+            recordLock(*recorder_, *this, nullptr, 0);
+        }
+    }
+    path_begin_ = path_end_;
+
+    board_.place(current_piece_, current_pos_);
     int cleared = board_.clearLines();
 
     if (cleared > 0) {
         lines_cleared_ += cleared;
-        // Score: 100 for 1 line, 300 for 2, 500 for 3, 800 for 4
-        int points[] = {0, 100, 300, 500, 800};
-        score_ += points[cleared] * level_;
+        score_ += lineClearScore(cleared, level_);
         level_ = 1 + lines_cleared_ / 10;
     }
 
@@ -104,4 +246,8 @@ void Game::lockPiece() {
     }
 }
 
+#define TETRIS_DEFINE_GAME(W, H) template class BasicGame<W, H>;
+TETRIS_BOARD_SIZES(TETRIS_DEFINE_GAME)
+#undef TETRIS_DEFINE_GAME
+
 } // namespace tetris
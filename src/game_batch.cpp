@@ -0,0 +1,190 @@
+#include <tetris/game_batch.hpp>
+#include <tetris/profiler.hpp>
+#include <tetris/simulation.hpp>
+#include <algorithm>
+
+namespace tetris {
+
+GameBatch::GameBatch(int num_games, std::uint64_t seed, RandomizerKind kind,
+                     int preview_size)
+    : num_games_(std::max(num_games, 0)), seed_(seed),
+      preview_size_(std::clamp(preview_size, 0, MAX_PREVIEW_SIZE)), piece_limit_(0),
+      pool_(std::make_unique<ThreadPool>(0)) {
+    auto count = static_cast<std::size_t>(num_games_);
+    boards_.resize(count);
+    pieces_.assign(count, Tetromino(TetrominoType::I));
+    positions_.assign(count, SPAWN_POSITION);
+    previews_.resize(count);
+    randomizers_.reserve(count);
+    scores_.assign(count, 0);
+    levels_.assign(count, 1);
+    lines_.assign(count, 0);
+    piece_counts_.assign(count, 0);
+    states_.assign(count, GameState::PLAYING);
+
+    // Draw the first piece, then the preview behind it, as Game does
+    for (std::size_t i = 0; i < count; i++) {
+        randomizers_.emplace_back(getSeed(static_cast<int>(i)), kind);
+        TetrominoType first = randomizers_[i].next();
+        for (int k = 0; k < preview_size_; k++) {
+            previews_[i][static_cast<std::size_t>(k)] = randomizers_[i].next();
+        }
+        pieces_[i] = Tetromino(first);
+    }
+    makeAIs();
+}
+
+std::uint64_t GameBatch::getSeed(int game) const {
+    return gameSeed(seed_, game);
+}
+
+void GameBatch::setThreads(int threads) {
+    pool_ = std::make_unique<ThreadPool>(threads);
+    makeAIs();
+}
+
+void GameBatch::setSearchConfig(const AI::SearchConfig &config) {
+    search_ = config;
+    search_.threads = 1;
+    makeAIs();
+}
+
+void GameBatch::setWeights(const EvalWeights &weights) {
+    weights_ = weights;
+    for (auto &ai : ais_) {
+        ai->setWeights(weights_);
+    }
+}
+
+void GameBatch::makeAIs() {
+    ais_.clear();
+    for (int worker = 0; worker < pool_->getNumThreads(); worker++) {
+        ais_.push_back(std::make_unique<AI>(search_));
+        ais_.back()->setWeights(weights_);
+    }
+}
+
+bool GameBatch::isActive(int game) const {
+    return states_[index(game)] == GameState::PLAYING &&
+           (piece_limit_ <= 0 || piece_counts_[index(game)] < piece_limit_);
+}
+
+int GameBatch::getActiveGames() const {
+    int active = 0;
+    for (int i = 0; i < num_games_; i++) {
+        active += isActive(i) ? 1 : 0;
+    }
+    return active;
+}
+
+void GameBatch::step() {
+    // Every game is a task, searched by the AI of whichever thread runs it
+    pool_->parallelForWorkers(num_games_, [this](int worker, int game) {
+        if (isActive(game)) {
+            makeAIMove(*ais_[static_cast<std::size_t>(worker)], index(game));
+        }
+    });
+}
+
+void GameBatch::reset() {
+    for (std::size_t i = 0; i < boards_.size(); i++) {
+        boards_[i].reset();
+        scores_[i] = 0;
+        levels_[i] = 1;
+        lines_[i] = 0;
+        piece_counts_[i] = 0;
+        states_[i] = GameState::PLAYING;
+        spawnNewPiece(i);
+    }
+}
+
+void GameBatch::makeAIMove(AI &ai, std::size_t game) {
+    Board &board = boards_[game];
+    AI::Move move = ai.findBestMove(AI::SearchRoot{&board, pieces_[game], positions_[game],
+                                                   previews_[game].data(), preview_size_});
+
+    // Lock the piece where the AI wants it if it comes to rest there, as
+    // Game::applyPlacement would, or drop it straight down
+    Tetromino piece(pieces_[game].getType(), move.rotation);
+    Position pos{move.x, move.y};
+    if (board.canPlace(piece, pos) && !board.canPlace(piece, {pos.x, pos.y + 1})) {
+        pieces_[game] = piece;
+        positions_[game] = pos;
+    } else {
+        Position &current = positions_[game];
+        while (board.canPlace(pieces_[game], {current.x, current.y + 1})) {
+            current.y++;
+        }
+    }
+    lockPiece(game);
+}
+
+void GameBatch::spawnNewPiece(std::size_t game) {
+    Preview &preview = previews_[game];
+    TetrominoType type;
+    if (preview_size_ > 0) {
+        type = preview[0];
+        std::copy(preview.begin() + 1, preview.begin() + preview_size_, preview.begin());
+        preview[static_cast<std::size_t>(preview_size_ - 1)] = randomizers_[game].next();
+    } else {
+        type = randomizers_[game].next();
+    }
+
+    pieces_[game] = Tetromino(type);
+    positions_[game] = SPAWN_POSITION;
+    if (!boards_[game].canPlace(pieces_[game], positions_[game])) {
+        states_[game] = GameState::GAME_OVER;
+    }
+}
+
+void GameBatch::lockPiece(std::size_t game) {
+    TETRIS_PROFILE_SCOPE(Probe::LOCK_PIECE);
+    Board &board = boards_[game];
+    board.place(pieces_[game], positions_[game]);
+    int cleared = board.clearLines();
+    piece_counts_[game]++;
+
+    if (cleared > 0) {
+        lines_[game] += cleared;
+        scores_[game] += lineClearScore(cleared, levels_[game]);
+        levels_[game] = 1 + lines_[game] / 10;
+    }
+
+    if (board.isGameOver()) {
+        states_[game] = GameState::GAME_OVER;
+    } else {
+        spawnNewPiece(game);
+    }
+}
+
+void GameBatch::captureSnapshot(int game, GameSnapshot &snapshot) const {
+    const Board &board = getBoard(game);
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        for (int x = 0; x < BOARD_WIDTH; x++) {
+            snapshot.cells[static_cast<std::size_t>(y)][static_cast<std::size_t>(x)] =
+                static_cast<std::uint8_t>(board.getCell(x, y));
+        }
+    }
+    snapshot.piece = getCurrentPiece(game).getType();
+    snapshot.rotation = static_cast<std::uint8_t>(getCurrentPiece(game).getRotation());
+    snapshot.state = getState(game);
+    snapshot.pos = getCurrentPosition(game);
+    snapshot.score = getScore(game);
+    snapshot.level = getLevel(game);
+    snapshot.lines = getLinesCleared(game);
+}
+
+std::size_t GameBatch::getBytesPerGame() {
+    return sizeof(Board) + sizeof(Tetromino) + sizeof(Position) + sizeof(Preview) +
+           sizeof(Randomizer) + 4 * sizeof(int) + sizeof(GameState);
+}
+
+std::size_t GameBatch::getMemoryUsage() const {
+    std::size_t bytes = sizeof(*this) + getBytesPerGame() * boards_.size();
+    for (const auto &ai : ais_) {
+        bytes += sizeof(AI) + ai->getTranspositionTable().getMemoryUsage();
+    }
+    return bytes;
+}
+
+} // namespace tetris
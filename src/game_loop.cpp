@@ -0,0 +1,39 @@
+#include <tetris/game_loop.hpp>
+
+namespace tetris {
+
+FixedTimestep::FixedTimestep(Clock::duration step, double speed, Clock::time_point start)
+    : step_(step), speed_(0.0), scaled_step_(step), next_(start) {
+    setSpeed(speed, start);
+}
+
+void FixedTimestep::setSpeed(double speed, Clock::time_point now) {
+    speed_ = speed;
+    if (speed_ > 0.0) {
+        scaled_step_ = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double, Clock::period>(static_cast<double>(step_.count()) /
+                                                         speed_));
+        if (scaled_step_ <= Clock::duration::zero()) {
+            scaled_step_ = Clock::duration(1);
+        }
+    }
+    next_ = now + scaled_step_;
+}
+
+int FixedTimestep::advance(Clock::time_point now) {
+    if (isUnlimited()) {
+        return UNLIMITED_BATCH;
+    }
+    int steps = 0;
+    while (next_ <= now && steps < MAX_CATCH_UP) {
+        next_ += scaled_step_;
+        steps++;
+    }
+    if (next_ <= now) {
+        // Too far behind, carry on from now instead of bursting
+        next_ = now + scaled_step_;
+    }
+    return steps;
+}
+
+} // namespace tetris
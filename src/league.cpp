@@ -0,0 +1,64 @@
+#include <tetris/league.hpp>
+
+#include <algorithm>
+
+namespace tetris {
+
+bool ranksAbove(const PlayerStanding &a, const PlayerStanding &b) {
+    if (a.score != b.score) {
+        return a.score > b.score;
+    }
+    if (a.lines != b.lines) {
+        return a.lines > b.lines;
+    }
+    return a.player < b.player;
+}
+
+void LeagueView::capture(const MultiPlayerGame &match, const PageRequest &page,
+                         LeagueFrame &frame) {
+    const GameBatch &games = match.getGames();
+    int num_players = games.getNumGames();
+    standings_.resize(static_cast<std::size_t>(num_players));
+    frame.num_players = num_players;
+    frame.active_players = 0;
+    frame.total_lines = 0;
+    for (int i = 0; i < num_players; i++) {
+        PlayerStanding &standing = standings_[static_cast<std::size_t>(i)];
+        standing = {i, games.getScore(i), games.getLinesCleared(i), games.getLevel(i),
+                    games.getState(i)};
+        frame.active_players += standing.state == GameState::PLAYING ? 1 : 0;
+        frame.total_lines += standing.lines;
+    }
+
+    frame.page = page;
+    frame.page.size = std::clamp(page.size, 0, MAX_PAGE_BOARDS);
+    frame.page.first = std::clamp(page.first, 0, std::max(num_players - 1, 0));
+    frame.num_boards = std::clamp(num_players - frame.page.first, 0, frame.page.size);
+
+    // Only the ranks that are shown have to be sorted
+    int ranked = std::min(num_players, LEADERBOARD_SIZE);
+    if (frame.page.order == PageOrder::RANK) {
+        ranked = std::max(ranked, frame.page.first + frame.num_boards);
+    }
+    std::partial_sort(standings_.begin(), standings_.begin() + ranked, standings_.end(),
+                      ranksAbove);
+
+    frame.num_leaders = std::min(num_players, LEADERBOARD_SIZE);
+    std::copy(standings_.begin(), standings_.begin() + frame.num_leaders,
+              frame.leaders.begin());
+
+    for (int i = 0; i < frame.num_boards; i++) {
+        auto slot = static_cast<std::size_t>(i);
+        int position = frame.page.first + i;
+        if (frame.page.order == PageOrder::RANK) {
+            frame.board_ranks[slot] = position;
+            frame.board_players[slot] = standings_[static_cast<std::size_t>(position)].player;
+        } else {
+            frame.board_ranks[slot] = -1;
+            frame.board_players[slot] = position;
+        }
+        games.captureSnapshot(frame.board_players[slot], frame.boards[slot]);
+    }
+}
+
+} // namespace tetris
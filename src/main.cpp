@@ -1,19 +1,49 @@
 #include <tetris/ai.hpp>
 #include <tetris/game.hpp>
+#include <tetris/game_loop.hpp>
+#include <tetris/league.hpp>
 #include <tetris/multiplayer.hpp>
+#include <tetris/profiler.hpp>
 #include <tetris/renderer.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdlib>
 #include <iostream>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Simulation step length at speed 1
+constexpr auto SINGLE_PLAYER_STEP = std::chrono::milliseconds(16);
+constexpr auto MULTI_PLAYER_STEP = std::chrono::milliseconds(100);
+// Gravity in single-player manual mode, in steps (about 500 ms)
+constexpr int GRAVITY_STEPS = 30;
+constexpr int DEFAULT_FPS = 60;
 
 void printUsage(const char *program_name) {
-    std::cout << "Usage: " << program_name << " [num_players]\n";
-    std::cout << "  num_players: Number of AI players (1-8, default: 2)\n";
+    std::cout << "Usage: " << program_name << " [num_players] [options]\n";
+    std::cout << "  num_players: Number of AI players (default: 2)\n";
+    std::cout << "\nOptions:\n";
+    std::cout << "  --speed X  Simulation speed multiplier, 0 = as fast as possible\n";
+    std::cout << "             (default: 1)\n";
+    std::cout << "  --fps N    Frame rate cap (default: 60)\n";
+    std::cout << "  --profile FILE\n";
+    std::cout << "             Write hot-path latencies to FILE at exit, as CSV if it\n";
+    std::cout << "             ends in .csv and JSON otherwise (needs -DTETRIS_PROFILE=ON)\n";
     std::cout << "\nControls:\n";
     std::cout << "  R - Reset game(s)\n";
     std::cout << "  Q - Quit\n";
+    std::cout << "\nFor multi-player mode:\n";
+    std::cout << "  [ ] or PgUp/PgDn - Previous/next page of boards\n";
+    std::cout << "  Home - First page\n";
+    std::cout << "  V - Show boards by rank or by player number\n";
     std::cout << "\nFor single player mode (num_players=1):\n";
     std::cout << "  A - Toggle AI auto-play\n";
     std::cout << "  Arrow keys - Move piece\n";
@@ -21,149 +51,310 @@ void printUsage(const char *program_name) {
     std::cout << "  Space - Hard drop\n";
 }
 
+// Keys read by the render thread, applied by the simulation thread at its
+// next step
+class KeyQueue {
+  public:
+    void push(int key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        keys_.push_back(key);
+    }
+
+    // Move the pending keys into out, which is cleared first
+    void drain(std::vector<int> &out) {
+        out.clear();
+        std::lock_guard<std::mutex> lock(mutex_);
+        out.swap(keys_);
+    }
+
+  private:
+    std::mutex mutex_;
+    std::vector<int> keys_;
+};
+
+// Simulation thread body: run due steps on the fixed timestep and publish
+// the state after each batch, until running turns false
+template <typename Step, typename Publish>
+void simulationLoop(const std::atomic<bool> &running, tetris::FixedTimestep &timestep,
+                    Step &&step, Publish &&publish) {
+    while (running.load(std::memory_order_relaxed)) {
+        int steps = timestep.advance(Clock::now());
+        if (steps > 0) {
+            step(steps);
+            publish();
+        }
+        if (!timestep.isUnlimited()) {
+            // Wake up at least every 10 ms so quitting stays responsive
+            std::this_thread::sleep_until(
+                std::min(timestep.nextStepTime(), Clock::now() + std::chrono::milliseconds(10)));
+        }
+    }
+}
+
+// Render thread body: forward keys and draw the latest state at most fps
+// times a second, until Q is pressed
+template <typename OnKey, typename Draw>
+void renderLoop(std::atomic<bool> &running, int fps, OnKey &&on_key, Draw &&draw) {
+    auto frame =
+        std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    auto next_frame = Clock::now();
+    while (running.load(std::memory_order_relaxed)) {
+        {
+            TETRIS_PROFILE_SCOPE(tetris::Probe::FRAME);
+            // Handle input
+            int ch;
+            while ((ch = getch()) != ERR) {
+                if (ch == 'q' || ch == 'Q') {
+                    running.store(false, std::memory_order_relaxed);
+                } else {
+                    on_key(ch);
+                }
+            }
+
+            draw();
+        }
+
+        // Frames that run late do not make the next ones come sooner
+        next_frame += frame;
+        auto now = Clock::now();
+        if (next_frame < now) {
+            next_frame = now;
+        }
+        std::this_thread::sleep_until(next_frame);
+    }
+}
+
+} // namespace
+
 int main(int argc, char *argv[]) {
     int num_players = 2; // Default to 2 players
+    double speed = 1.0;
+    int fps = DEFAULT_FPS;
+    std::string profile_path;
 
     // Parse command line arguments
-    if (argc > 1) {
-        if (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
             printUsage(argv[0]);
             return 0;
         }
-        num_players = std::atoi(argv[1]);
-        if (num_players < 1 || num_players > 8) {
-            std::cerr << "Error: Number of players must be between 1 and 8\n";
+        if ((arg == "--speed" || arg == "--fps" || arg == "--profile") && i + 1 < argc) {
+            const char *value = argv[++i];
+            if (arg == "--speed") {
+                speed = std::atof(value);
+            } else if (arg == "--fps") {
+                fps = std::atoi(value);
+            } else {
+                profile_path = value;
+            }
+            continue;
+        }
+        num_players = std::atoi(argv[i]);
+        if (num_players < 1) {
+            std::cerr << "Error: Number of players must be at least 1\n";
             printUsage(argv[0]);
             return 1;
         }
     }
+    if (fps < 1) {
+        std::cerr << "Error: Frame rate must be at least 1\n";
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (!profile_path.empty() && !tetris::PROFILING_ENABLED) {
+        std::cerr << "Warning: Built without -DTETRIS_PROFILE=ON, " << profile_path
+                  << " will hold no samples\n";
+    }
 
     tetris::Renderer renderer;
     renderer.init();
 
-    bool running = true;
+    // The simulation thread owns the games. The render thread (this one)
+    // only sees the snapshots they publish through lock-free triple
+    // buffers, so a slow AI decision never stalls a frame, drawing never
+    // stalls the simulation and the frame rate never changes the game
+    // speed.
+    std::atomic<bool> running{true};
+    KeyQueue keys;
 
     if (num_players == 1) {
         // Single player mode with manual control option
         tetris::Game game;
-        tetris::AI ai;
-        bool auto_play = true; // Start in auto-play mode by default
-        auto last_update = std::chrono::steady_clock::now();
-        int update_interval = 500; // ms
+        tetris::TripleBuffer<tetris::GameSnapshot> published;
+        auto publish = [&] {
+            game.captureSnapshot(published.writeSlot());
+            published.publish();
+        };
+        publish();
 
-        while (running) {
-            auto now = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                               now - last_update)
-                               .count();
+        std::thread simulation([&] {
+            tetris::AI ai;
+            bool auto_play = true; // Start in auto-play mode by default
+            int gravity_steps = 0;
+            std::vector<int> pending;
+            tetris::FixedTimestep timestep(SINGLE_PLAYER_STEP, speed, Clock::now());
 
-            // Handle input
-            int ch = getch();
-            switch (ch) {
-            case 'q':
-            case 'Q':
-                running = false;
-                break;
-            case 'r':
-            case 'R':
-                game.reset();
-                break;
-            case 'a':
-            case 'A':
-                auto_play = !auto_play;
-                break;
-            case KEY_LEFT:
-                if (!auto_play)
-                    game.moveLeft();
-                break;
-            case KEY_RIGHT:
-                if (!auto_play)
-                    game.moveRight();
-                break;
-            case KEY_DOWN:
-                if (!auto_play)
-                    game.moveDown();
-                break;
-            case KEY_UP:
-                if (!auto_play)
-                    game.rotate();
-                break;
-            case ' ':
-                if (!auto_play)
-                    game.drop();
-                break;
-            }
+            auto step = [&](int steps) {
+                keys.drain(pending);
+                for (int key : pending) {
+                    switch (key) {
+                    case 'r':
+                    case 'R':
+                        game.reset();
+                        break;
+                    case 'a':
+                    case 'A':
+                        auto_play = !auto_play;
+                        break;
+                    case KEY_LEFT:
+                        if (!auto_play)
+                            game.moveLeft();
+                        break;
+                    case KEY_RIGHT:
+                        if (!auto_play)
+                            game.moveRight();
+                        break;
+                    case KEY_DOWN:
+                        if (!auto_play)
+                            game.moveDown();
+                        break;
+                    case KEY_UP:
+                        if (!auto_play)
+                            game.rotate();
+                        break;
+                    case ' ':
+                        if (!auto_play)
+                            game.drop();
+                        break;
+                    }
+                }
 
-            // Auto play mode
-            if (auto_play && game.getState() == tetris::GameState::PLAYING) {
-                tetris::AI::Move move = ai.findBestMove(game);
+                for (int i = 0; i < steps; i++) {
+                    if (auto_play) {
+                        // One AI move per step
+                        if (game.getState() == tetris::GameState::PLAYING) {
+                            tetris::AI::Move move = ai.findBestMove(game);
 
-                // Apply rotations
-                for (int i = 0; i < move.rotation; i++) {
-                    game.rotate();
+                            // Lock the piece where the AI wants it, or drop it
+                            // if no move was found
+                            if (!game.applyPlacement(move.rotation, {move.x, move.y})) {
+                                game.drop();
+                            }
+                        }
+                    } else if (++gravity_steps >= GRAVITY_STEPS) {
+                        gravity_steps = 0;
+                        game.update();
+                    }
                 }
+            };
+            simulationLoop(running, timestep, step, publish);
+        });
 
-                // Move to target x position
-                tetris::Position current_pos = game.getCurrentPosition();
-                while (current_pos.x < move.x) {
-                    game.moveRight();
-                    current_pos = game.getCurrentPosition();
+        renderLoop(
+            running, fps, [&](int key) { keys.push(key); },
+            [&] {
+                if (!published.fetch()) {
+                    return;
                 }
-                while (current_pos.x > move.x) {
-                    game.moveLeft();
-                    current_pos = game.getCurrentPosition();
+                const tetris::GameSnapshot &frame = published.read();
+                if (frame.state == tetris::GameState::PLAYING) {
+                    renderer.render(frame);
+                } else {
+                    renderer.renderGameOver(frame);
                 }
-
-                // Drop the piece
-                game.drop();
-            }
-
-            // Update game
-            if (elapsed >= update_interval && !auto_play) {
-                game.update();
-                last_update = now;
-            }
-
-            // Render
-            if (game.getState() == tetris::GameState::PLAYING) {
-                renderer.render(game);
-            } else {
-                renderer.renderGameOver(game);
-            }
-
-            std::this_thread::sleep_for(
-                std::chrono::milliseconds(16)); // ~60 FPS
-        }
+            });
+        simulation.join();
     } else {
-        // Multi-player mode - all AI
+        // Multi-player mode - all AI. Only the boards on the current page
+        // are copied out of the simulation and drawn, the rest of the
+        // players show up in the leaderboard.
         tetris::MultiPlayerGame mp_game(num_players);
+        tetris::LeagueView league;
+        tetris::PageRequest page;
+        page.size = renderer.getPageCapacity();
+        // Page requests go from the render thread to the simulation, frames
+        // the other way
+        tetris::TripleBuffer<tetris::PageRequest> requests;
+        tetris::TripleBuffer<tetris::LeagueFrame> published;
+        league.capture(mp_game, page, published.writeSlot());
+        published.publish();
 
-        while (running) {
-            // Handle input
-            int ch = getch();
-            switch (ch) {
-            case 'q':
-            case 'Q':
-                running = false;
+        std::thread simulation([&] {
+            std::vector<int> pending;
+            tetris::PageRequest wanted = page;
+            tetris::FixedTimestep timestep(MULTI_PLAYER_STEP, speed, Clock::now());
+            auto step = [&](int steps) {
+                keys.drain(pending);
+                if (std::find(pending.begin(), pending.end(), 'r') != pending.end() ||
+                    std::find(pending.begin(), pending.end(), 'R') != pending.end()) {
+                    mp_game.reset();
+                }
+                // Update all games. A batch over a big league can take a
+                // while, stop early when quitting.
+                for (int i = 0; i < steps && running.load(std::memory_order_relaxed); i++) {
+                    mp_game.update();
+                }
+            };
+            auto publish = [&] {
+                if (requests.fetch()) {
+                    wanted = requests.read();
+                }
+                league.capture(mp_game, wanted, published.writeSlot());
+                published.publish();
+            };
+            simulationLoop(running, timestep, step, publish);
+        });
+
+        // Paging is handled here, everything else goes to the simulation
+        auto on_key = [&](int key) {
+            int first = page.first;
+            switch (key) {
+            case ']':
+            case KEY_NPAGE:
+                if (first + page.size < num_players) {
+                    first += page.size;
+                }
+                break;
+            case '[':
+            case KEY_PPAGE:
+                first = std::max(first - page.size, 0);
+                break;
+            case KEY_HOME:
+                first = 0;
                 break;
-            case 'r':
-            case 'R':
-                mp_game.reset();
+            case 'v':
+            case 'V':
+                page.order = page.order == tetris::PageOrder::RANK ? tetris::PageOrder::PLAYER
+                                                                   : tetris::PageOrder::RANK;
+                first = 0;
                 break;
+            default:
+                keys.push(key);
+                return;
             }
-
-            // Update all games
-            mp_game.update();
-
-            // Render all games
-            renderer.renderMultiPlayer(mp_game);
-
-            std::this_thread::sleep_for(
-                std::chrono::milliseconds(100)); // Slower for multi-player
-        }
+            page.first = first;
+            requests.publish(page);
+        };
+        renderLoop(running, fps, on_key, [&] {
+            int capacity = renderer.getPageCapacity();
+            if (capacity != page.size) {
+                // Keep the first board of the page in view after a resize
+                page.first = page.first / std::max(capacity, 1) * capacity;
+                page.size = capacity;
+                requests.publish(page);
+            }
+            if (published.fetch()) {
+                renderer.renderMultiPlayer(published.read());
+            }
+        });
+        simulation.join();
     }
 
     renderer.cleanup();
+    if (!profile_path.empty() && !tetris::writeProbes(profile_path)) {
+        std::cerr << "Error: Cannot write " << profile_path << "\n";
+        return 1;
+    }
     return 0;
 }
-
@@ -0,0 +1,273 @@
+#include <tetris/move_generator.hpp>
+
+namespace tetris {
+
+template <int Width, int Height>
+auto BasicMoveGenerator<Width, Height>::generate(const Board &board, const Tetromino &piece,
+                                                Position pos)
+    -> const std::vector<Placement> & {
+    type_ = piece.getType();
+    start_rotation_ = piece.getRotation();
+    start_pos_ = pos;
+    placements_.clear();
+    computeFits(board);
+
+    int start_column = pos.x + X_OFFSET;
+    if (pos.y < 0 || !fits(start_rotation_, pos.y, start_column)) {
+        return placements_;
+    }
+    for (auto &rows : reached_) {
+        rows.fill(0);
+    }
+    reached_[static_cast<std::size_t>(start_rotation_)][static_cast<std::size_t>(pos.y)] =
+        static_cast<ColumnMask>(Word{1} << start_column);
+    floodFill();
+
+    // Report each resting spot once, preferring the lowest rotation with the
+    // same cells, in rotation, x, y order
+    const auto &shapes = SHAPE_TABLE[static_cast<std::size_t>(type_)];
+    for (int r = 0; r < NUM_ROTATIONS; r++) {
+        auto rotation = static_cast<std::size_t>(r);
+        auto canonical = static_cast<std::size_t>(shapes[rotation].canonical_rotation);
+        RowMasks resting{};
+        for (std::size_t y = 0; y < Height; y++) {
+            ColumnMask below = y + 1 < Height ? fits_[rotation][y + 1] : 0;
+            ColumnMask duplicate = canonical != rotation ? reached_[canonical][y] : 0;
+            resting[y] = static_cast<ColumnMask>(reached_[rotation][y] & ~below & ~duplicate);
+        }
+        for (int column = 0; column < NUM_COLUMNS; column++) {
+            for (int y = 0; y < Height; y++) {
+                if ((resting[static_cast<std::size_t>(y)] >> column) & 1) {
+                    placements_.push_back({r, {column - X_OFFSET, y}});
+                }
+            }
+        }
+    }
+    return placements_;
+}
+
+template <int Width, int Height>
+void BasicMoveGenerator<Width, Height>::computeFits(const Board &board) {
+    const auto &shapes = SHAPE_TABLE[static_cast<std::size_t>(type_)];
+    for (std::size_t r = 0; r < NUM_ROTATIONS; r++) {
+        const ShapeInfo &shape = shapes[r];
+        // Columns that keep the piece inside the walls
+        int lowest = X_OFFSET - shape.min_x;
+        int highest = Width - 1 - shape.max_x + X_OFFSET;
+        Word inside = ((Word{2} << highest) - 1) & ~((Word{1} << lowest) - 1);
+
+        for (int y = 0; y < Height; y++) {
+            auto &fit = fits_[r][static_cast<std::size_t>(y)];
+            if (y + shape.max_y >= Height) {
+                fit = 0;
+                continue;
+            }
+            // A column is blocked if any block would land on an occupied cell
+            Word blocked = 0;
+            for (int dy = shape.min_y; dy <= shape.max_y; dy++) {
+                Word row = board.getRow(y + dy);
+                unsigned mask = shape.row_masks[static_cast<std::size_t>(dy)];
+                for (int dx = 0; dx < 4; dx++) {
+                    if ((mask >> dx) & 1) {
+                        blocked |= row << (X_OFFSET - dx);
+                    }
+                }
+            }
+            fit = static_cast<ColumnMask>(inside & ~blocked);
+        }
+    }
+}
+
+template <int Width, int Height>
+void BasicMoveGenerator<Width, Height>::floodFill() {
+    // Nothing moves up, so each row is settled before falling to the next
+    for (std::size_t y = 0; y < Height; y++) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (std::size_t r = 0; r < NUM_ROTATIONS; r++) {
+                Word reached = reached_[r][y];
+                if (reached == 0) {
+                    continue;
+                }
+
+                // Slide left and right as far as the row allows
+                Word fit = fits_[r][y];
+                while (true) {
+                    Word next = (reached | (reached << 1) | (reached >> 1)) & fit;
+                    if (next == reached) {
+                        break;
+                    }
+                    reached = next;
+                }
+                reached_[r][y] = static_cast<ColumnMask>(reached);
+
+                // Rotate in place, else kick one column left, else one right
+                std::size_t next_rotation = (r + 1) % NUM_ROTATIONS;
+                Word target_fit = fits_[next_rotation][y];
+                Word in_place = reached & target_fit;
+                Word blocked = reached & ~target_fit;
+                Word kicked_left = (blocked >> 1) & target_fit;
+                Word kicked_right =
+                    ((blocked & ~(target_fit << 1)) << 1) & target_fit;
+                Word rotated = in_place | kicked_left | kicked_right;
+                Word known = reached_[next_rotation][y];
+                if (rotated & ~known) {
+                    reached_[next_rotation][y] = static_cast<ColumnMask>(known | rotated);
+                    changed = true;
+                }
+            }
+        }
+
+        // Fall one row wherever the piece still fits
+        if (y + 1 < Height) {
+            for (std::size_t r = 0; r < NUM_ROTATIONS; r++) {
+                auto falling = static_cast<ColumnMask>(reached_[r][y] & fits_[r][y + 1]);
+                reached_[r][y + 1] = static_cast<ColumnMask>(reached_[r][y + 1] | falling);
+            }
+        }
+    }
+}
+
+template <int Width, int Height>
+bool BasicMoveGenerator<Width, Height>::rotateTarget(int rotation, int y, int column,
+                                                    int &target_column) const {
+    int next_rotation = (rotation + 1) % NUM_ROTATIONS;
+    for (int kick : {0, -1, 1}) {
+        if (fits(next_rotation, y, column + kick)) {
+            target_column = column + kick;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <int Width, int Height>
+bool BasicMoveGenerator<Width, Height>::directPath(const Placement &placement,
+                                                  InputPath &path) const {
+    // Rotate, shift and drop without leaving the starting row
+    int y = start_pos_.y;
+    int rotation = start_rotation_;
+    int column = start_pos_.x + X_OFFSET;
+    int target_column = placement.pos.x + X_OFFSET;
+    while (rotation != placement.rotation) {
+        if (!rotateTarget(rotation, y, column, column)) {
+            path.length = 0;
+            return false;
+        }
+        rotation = (rotation + 1) % NUM_ROTATIONS;
+        path.inputs[static_cast<std::size_t>(path.length++)] = Input::ROTATE;
+    }
+    int step = target_column > column ? 1 : -1;
+    Input shift = step > 0 ? Input::RIGHT : Input::LEFT;
+    for (; column != target_column; column += step) {
+        if (!fits(rotation, y, column + step) ||
+            path.length + 1 >= InputPath::MAX_INPUTS) {
+            path.length = 0;
+            return false;
+        }
+        path.inputs[static_cast<std::size_t>(path.length++)] = shift;
+    }
+
+    // The hard drop has to stop exactly on the placement
+    while (fits(rotation, y + 1, column)) {
+        y++;
+    }
+    if (y != placement.pos.y) {
+        path.length = 0;
+        return false;
+    }
+    path.inputs[static_cast<std::size_t>(path.length++)] = Input::DROP;
+    return true;
+}
+
+template <int Width, int Height>
+bool BasicMoveGenerator<Width, Height>::findPath(const Placement &placement,
+                                                InputPath &path) {
+    path.length = 0;
+    int start_column = start_pos_.x + X_OFFSET;
+    int target_column = placement.pos.x + X_OFFSET;
+    if (start_pos_.y < 0 || !fits(start_rotation_, start_pos_.y, start_column) ||
+        !fits(placement.rotation, placement.pos.y, target_column)) {
+        return false;
+    }
+    if (directPath(placement, path)) {
+        return true;
+    }
+    std::uint16_t start = stateId(start_rotation_, start_pos_.y, start_column);
+    std::uint16_t target = stateId(placement.rotation, placement.pos.y, target_column);
+
+    // Breadth-first search over single inputs, stopping at the target
+    for (auto &rows : seen_) {
+        rows.fill(0);
+    }
+    auto visit = [&](int rotation, int y, int column, std::uint16_t from, Input input,
+                     std::size_t &tail) {
+        auto &seen = seen_[static_cast<std::size_t>(rotation)][static_cast<std::size_t>(y)];
+        if ((seen >> column) & 1) {
+            return;
+        }
+        seen = static_cast<ColumnMask>(seen | (Word{1} << column));
+        std::uint16_t id = stateId(rotation, y, column);
+        parent_[id] = from;
+        via_[id] = input;
+        queue_[tail++] = id;
+    };
+
+    std::size_t head = 0;
+    std::size_t tail = 0;
+    visit(start_rotation_, start_pos_.y, start_column, start, Input::DROP, tail);
+    bool found = false;
+    while (head < tail && !found) {
+        std::uint16_t id = queue_[head++];
+        int column = id % NUM_COLUMNS;
+        int y = (id / NUM_COLUMNS) % Height;
+        int rotation = id / (NUM_COLUMNS * Height);
+
+        if (fits(rotation, y, column - 1)) {
+            visit(rotation, y, column - 1, id, Input::LEFT, tail);
+        }
+        if (fits(rotation, y, column + 1)) {
+            visit(rotation, y, column + 1, id, Input::RIGHT, tail);
+        }
+        if (fits(rotation, y + 1, column)) {
+            visit(rotation, y + 1, column, id, Input::DOWN, tail);
+        }
+        int rotated_column = 0;
+        if (rotateTarget(rotation, y, column, rotated_column)) {
+            visit((rotation + 1) % NUM_ROTATIONS, y, rotated_column, id, Input::ROTATE, tail);
+        }
+        found = (seen_[static_cast<std::size_t>(placement.rotation)]
+                      [static_cast<std::size_t>(placement.pos.y)] >>
+                 target_column) & 1;
+    }
+    if (!found) {
+        return false;
+    }
+
+    // Walk back to the start, then let a hard drop replace the final fall
+    std::array<Input, NUM_STATES> reversed;
+    int length = 0;
+    for (std::uint16_t id = target; id != start; id = parent_[id]) {
+        reversed[static_cast<std::size_t>(length++)] = via_[id];
+    }
+    int skipped = 0;
+    while (skipped < length && reversed[static_cast<std::size_t>(skipped)] == Input::DOWN) {
+        skipped++;
+    }
+    if (length - skipped + 1 > InputPath::MAX_INPUTS) {
+        return false;
+    }
+    for (int i = length - 1; i >= skipped; i--) {
+        path.inputs[static_cast<std::size_t>(path.length++)] =
+            reversed[static_cast<std::size_t>(i)];
+    }
+    path.inputs[static_cast<std::size_t>(path.length++)] = Input::DROP;
+    return true;
+}
+
+#define TETRIS_DEFINE_MOVE_GENERATOR(W, H) template class BasicMoveGenerator<W, H>;
+TETRIS_BOARD_SIZES(TETRIS_DEFINE_MOVE_GENERATOR)
+#undef TETRIS_DEFINE_MOVE_GENERATOR
+
+} // namespace tetris
@@ -1,71 +1,22 @@
 #include <tetris/multiplayer.hpp>
+#include <chrono>
 
 namespace tetris {
 
-MultiPlayerGame::MultiPlayerGame(int num_players) : num_players_(num_players) {
-    for (int i = 0; i < num_players_; i++) {
-        games_.push_back(std::make_unique<Game>());
-        ais_.push_back(std::make_unique<AI>());
-    }
-}
+MultiPlayerGame::MultiPlayerGame(int num_players)
+    : MultiPlayerGame(num_players,
+                      static_cast<std::uint64_t>(
+                          std::chrono::system_clock::now().time_since_epoch().count())) {}
 
-void MultiPlayerGame::update() {
-    for (int i = 0; i < num_players_; i++) {
-        if (games_[i]->getState() == GameState::PLAYING) {
-            makeAIMove(i);
-        }
-    }
-}
+MultiPlayerGame::MultiPlayerGame(int num_players, std::uint64_t seed)
+    : games_(num_players, seed) {}
 
-void MultiPlayerGame::reset() {
-    for (auto &game : games_) {
-        game->reset();
-    }
-}
+void MultiPlayerGame::update() { games_.step(); }
 
-bool MultiPlayerGame::isAnyPlaying() const {
-    for (const auto &game : games_) {
-        if (game->getState() == GameState::PLAYING) {
-            return true;
-        }
-    }
-    return false;
-}
+void MultiPlayerGame::reset() { games_.reset(); }
 
-int MultiPlayerGame::getActivePlayers() const {
-    int active = 0;
-    for (const auto &game : games_) {
-        if (game->getState() == GameState::PLAYING) {
-            active++;
-        }
-    }
-    return active;
-}
+bool MultiPlayerGame::isAnyPlaying() const { return games_.getActiveGames() > 0; }
 
-void MultiPlayerGame::makeAIMove(int player_id) {
-    Game &game = *games_[player_id];
-    AI &ai = *ais_[player_id];
-
-    AI::Move move = ai.findBestMove(game);
-
-    // Apply rotations
-    for (int i = 0; i < move.rotation; i++) {
-        game.rotate();
-    }
-
-    // Move to target x position
-    Position current_pos = game.getCurrentPosition();
-    while (current_pos.x < move.x) {
-        game.moveRight();
-        current_pos = game.getCurrentPosition();
-    }
-    while (current_pos.x > move.x) {
-        game.moveLeft();
-        current_pos = game.getCurrentPosition();
-    }
-
-    // Drop the piece
-    game.drop();
-}
+int MultiPlayerGame::getActivePlayers() const { return games_.getActiveGames(); }
 
 } // namespace tetris
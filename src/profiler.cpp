@@ -0,0 +1,160 @@
+#include <tetris/profiler.hpp>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <fstream>
+
+namespace tetris {
+
+namespace {
+
+constexpr std::array<const char *, NUM_PROBES> PROBE_NAMES = {"move", "lock", "clear",
+                                                              "render", "frame"};
+
+// Percentiles reported by the exports
+constexpr std::array<double, 4> EXPORT_PERCENTILES = {50.0, 90.0, 99.0, 99.9};
+
+int bitWidth(std::uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return value != 0 ? 64 - __builtin_clzll(value) : 0;
+#else
+    int width = 0;
+    while (value != 0) {
+        value >>= 1;
+        width++;
+    }
+    return width;
+#endif
+}
+
+} // namespace
+
+int LatencyHistogram::bucketIndex(std::uint64_t value) {
+    if (value < static_cast<std::uint64_t>(SUB_BUCKETS)) {
+        return static_cast<int>(value);
+    }
+    // value >> shift keeps the top SUB_BUCKET_BITS bits, in
+    // [HALF_BUCKETS, SUB_BUCKETS)
+    int shift = bitWidth(value) - SUB_BUCKET_BITS;
+    return shift * HALF_BUCKETS + static_cast<int>(value >> shift);
+}
+
+std::uint64_t LatencyHistogram::bucketValue(int index) {
+    if (index < SUB_BUCKETS) {
+        return static_cast<std::uint64_t>(index);
+    }
+    int shift = index / HALF_BUCKETS - 1;
+    auto top = static_cast<std::uint64_t>(index - shift * HALF_BUCKETS);
+    return (top << shift) + (std::uint64_t{1} << (shift - 1));
+}
+
+void LatencyHistogram::record(std::uint64_t nanoseconds) {
+    buckets_[static_cast<std::size_t>(bucketIndex(nanoseconds))].fetch_add(
+        1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(nanoseconds, std::memory_order_relaxed);
+    std::uint64_t max = max_.load(std::memory_order_relaxed);
+    while (nanoseconds > max &&
+           !max_.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (auto &bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::getMean() const {
+    std::uint64_t count = getCount();
+    return count > 0 ? static_cast<double>(sum_.load(std::memory_order_relaxed)) /
+                           static_cast<double>(count)
+                     : 0.0;
+}
+
+std::uint64_t LatencyHistogram::getPercentile(double percentile) const {
+    // Buckets may be counted while this runs, so go by their own total
+    std::uint64_t total = 0;
+    for (const auto &bucket : buckets_) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    auto rank =
+        static_cast<std::uint64_t>(percentile / 100.0 * static_cast<double>(total));
+    rank = std::max<std::uint64_t>(rank, 1);
+    std::uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        seen += buckets_[static_cast<std::size_t>(i)].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(bucketValue(i), getMax());
+        }
+    }
+    return getMax();
+}
+
+const char *probeName(Probe probe) {
+    return PROBE_NAMES[static_cast<std::size_t>(probe)];
+}
+
+LatencyHistogram &probeHistogram(Probe probe) {
+    static std::array<LatencyHistogram, NUM_PROBES> histograms;
+    return histograms[static_cast<std::size_t>(probe)];
+}
+
+void resetProbes() {
+    for (int i = 0; i < NUM_PROBES; i++) {
+        probeHistogram(static_cast<Probe>(i)).reset();
+    }
+}
+
+std::string formatProbesJson() {
+    std::string out = "{\n  \"unit\": \"ns\",\n  \"probes\": {";
+    for (int i = 0; i < NUM_PROBES; i++) {
+        auto probe = static_cast<Probe>(i);
+        const LatencyHistogram &histogram = probeHistogram(probe);
+        out += fmt::format("{}\n    \"{}\": {{\"count\": {}, \"mean\": {:.1f}",
+                           i > 0 ? "," : "", probeName(probe), histogram.getCount(),
+                           histogram.getMean());
+        for (double percentile : EXPORT_PERCENTILES) {
+            out += fmt::format(", \"p{}\": {}", percentile,
+                               histogram.getPercentile(percentile));
+        }
+        out += fmt::format(", \"max\": {}}}", histogram.getMax());
+    }
+    out += "\n  }\n}\n";
+    return out;
+}
+
+std::string formatProbesCsv() {
+    std::string out = "probe,count,mean";
+    for (double percentile : EXPORT_PERCENTILES) {
+        out += fmt::format(",p{}", percentile);
+    }
+    out += ",max\n";
+    for (int i = 0; i < NUM_PROBES; i++) {
+        auto probe = static_cast<Probe>(i);
+        const LatencyHistogram &histogram = probeHistogram(probe);
+        out += fmt::format("{},{},{:.1f}", probeName(probe), histogram.getCount(),
+                           histogram.getMean());
+        for (double percentile : EXPORT_PERCENTILES) {
+            out += fmt::format(",{}", histogram.getPercentile(percentile));
+        }
+        out += fmt::format(",{}\n", histogram.getMax());
+    }
+    return out;
+}
+
+bool writeProbes(const std::string &path) {
+    bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    std::ofstream out(path, std::ios::trunc);
+    out << (csv ? formatProbesCsv() : formatProbesJson());
+    return static_cast<bool>(out.flush());
+}
+
+} // namespace tetris
@@ -0,0 +1,26 @@
+#include <tetris/randomizer.hpp>
+#include <utility>
+
+namespace tetris {
+
+void Randomizer::refill() {
+    if (kind_ == RandomizerKind::UNIFORM) {
+        for (auto &type : block_) {
+            type = static_cast<TetrominoType>(rng_.below(NUM_TETROMINO_TYPES));
+        }
+    } else {
+        // Fisher-Yates shuffle of each bag
+        for (std::size_t bag = 0; bag < block_.size(); bag += NUM_TETROMINO_TYPES) {
+            TetrominoType *pieces = &block_[bag];
+            for (int i = 0; i < NUM_TETROMINO_TYPES; i++) {
+                pieces[i] = static_cast<TetrominoType>(i);
+            }
+            for (std::uint32_t i = NUM_TETROMINO_TYPES - 1; i > 0; i--) {
+                std::swap(pieces[i], pieces[rng_.below(i + 1)]);
+            }
+        }
+    }
+    cursor_ = 0;
+}
+
+} // namespace tetris
@@ -0,0 +1,488 @@
+#include <tetris/recording.hpp>
+
+#include <algorithm>
+#include <bitset>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <limits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tetris {
+
+namespace {
+
+// File layout, all integers little-endian:
+//   0  magic "TRPL"        4  version u8        5  randomizer u8
+//   6  keyframe interval u16                    8  seed u64
+//   16 pieces u32          20 keyframes u32     24 index offset u64
+//   32 final score i32     36 final lines i32   40 reserved
+// then the stream of keyframes and piece records, then the index of
+// keyframe offsets as u64. When the piece count is a multiple of the
+// interval, a closing keyframe of the final board ends the stream, so there
+// are always pieces / interval + 1 keyframes.
+constexpr char MAGIC[4] = {'T', 'R', 'P', 'L'};
+constexpr std::uint8_t VERSION = 2;
+constexpr std::size_t HEADER_SIZE = 48;
+
+// A record's varint is
+//   (((x + X_BIAS) * NUM_ROTATIONS + rotation) * NUM_TETROMINO_TYPES + type)
+//       << FLAG_BITS | flags
+// so a piece dropped straight down costs two bytes
+constexpr int X_BIAS = 4;
+constexpr int Y_BIAS = 4;
+constexpr int FLAG_BITS = 2;
+// The piece did not come straight down from its spawn row, its row follows
+constexpr unsigned FLAG_ROW = 1;
+// An input path follows
+constexpr unsigned FLAG_PATH = 2;
+
+using Cells = std::array<std::array<std::uint8_t, BOARD_WIDTH>, BOARD_HEIGHT>;
+
+void putVarint(std::vector<std::uint8_t> &out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+void putFixed(std::vector<std::uint8_t> &out, std::uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+    }
+}
+
+std::uint64_t getFixed(const std::uint8_t *data, int bytes) {
+    std::uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= static_cast<std::uint64_t>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+// Four-bit values packed two to a byte, low nibble first
+template <typename Get> void putNibbles(std::vector<std::uint8_t> &out, int count, Get &&get) {
+    for (int i = 0; i < count; i += 2) {
+        unsigned low = get(i);
+        unsigned high = i + 1 < count ? get(i + 1) : 0;
+        out.push_back(static_cast<std::uint8_t>(low | high << 4));
+    }
+}
+
+// Bounds-checked cursor over a mapped stream. Reading past the end sets
+// ok to false and returns zeros.
+struct Reader {
+    const std::uint8_t *pos;
+    const std::uint8_t *end;
+    bool ok = true;
+
+    std::uint8_t byte() {
+        if (pos == end) {
+            ok = false;
+            return 0;
+        }
+        return *pos++;
+    }
+
+    std::uint64_t varint() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            std::uint8_t next = byte();
+            value |= static_cast<std::uint64_t>(next & 0x7F) << shift;
+            if ((next & 0x80) == 0) {
+                return value;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+
+    int smallInt() {
+        std::uint64_t value = varint();
+        if (value > static_cast<std::uint64_t>(std::numeric_limits<int>::max())) {
+            ok = false;
+            return 0;
+        }
+        return static_cast<int>(value);
+    }
+
+    unsigned nibble(int index, const std::uint8_t *start) const {
+        unsigned packed = start[index / 2];
+        return index % 2 == 0 ? packed & 0xFu : packed >> 4;
+    }
+
+    // Skip count packed nibbles, returning where they start
+    const std::uint8_t *nibbles(int count) {
+        const std::uint8_t *start = pos;
+        auto bytes = static_cast<std::size_t>((count + 1) / 2);
+        if (static_cast<std::size_t>(end - pos) < bytes) {
+            ok = false;
+            return nullptr;
+        }
+        pos += bytes;
+        return start;
+    }
+};
+
+// The row a piece lands on when dropped straight down from its spawn row,
+// or min() when it does not fit there
+int dropRow(const Board &board, const Tetromino &piece, int x) {
+    int y = SPAWN_POSITION.y;
+    if (!board.canPlace(piece, {x, y})) {
+        return std::numeric_limits<int>::min();
+    }
+    while (board.canPlace(piece, {x, y + 1})) {
+        y++;
+    }
+    return y;
+}
+
+void writeKeyframe(std::vector<std::uint8_t> &out, const Game &game) {
+    const Board &board = game.getBoard();
+    putVarint(out, static_cast<std::uint64_t>(game.getScore()));
+    putVarint(out, static_cast<std::uint64_t>(game.getLinesCleared()));
+    int filled = 0;
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        putVarint(out, board.getRow(y));
+        filled += static_cast<int>(std::bitset<BOARD_WIDTH>(board.getRow(y)).count());
+    }
+    // Colors of the filled cells, top to bottom and left to right
+    std::vector<std::uint8_t> colors;
+    colors.reserve(static_cast<std::size_t>(filled));
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        for (int x = 0; x < BOARD_WIDTH; x++) {
+            if (board.getCell(x, y) != 0) {
+                colors.push_back(static_cast<std::uint8_t>(board.getCell(x, y)));
+            }
+        }
+    }
+    putNibbles(out, filled, [&](int i) { return colors[static_cast<std::size_t>(i)]; });
+}
+
+bool readKeyframe(Reader &in, Cells &cells, int &score, int &lines) {
+    score = in.smallInt();
+    lines = in.smallInt();
+    std::array<RowMask, BOARD_HEIGHT> rows{};
+    int filled = 0;
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        std::uint64_t row = in.varint();
+        if (row > FULL_ROW_MASK) {
+            return false;
+        }
+        rows[static_cast<std::size_t>(y)] = static_cast<RowMask>(row);
+        filled += static_cast<int>(std::bitset<BOARD_WIDTH>(row).count());
+    }
+    const std::uint8_t *colors = in.nibbles(filled);
+    if (!in.ok) {
+        return false;
+    }
+    int next = 0;
+    for (int y = 0; y < BOARD_HEIGHT; y++) {
+        for (int x = 0; x < BOARD_WIDTH; x++) {
+            std::uint8_t &cell = cells[static_cast<std::size_t>(y)][static_cast<std::size_t>(x)];
+            cell = 0;
+            if (rows[static_cast<std::size_t>(y)] & (1u << x)) {
+                cell = static_cast<std::uint8_t>(in.nibble(next++, colors));
+                if (cell == 0 || cell > NUM_TETROMINO_TYPES) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Decode the record of a piece locking on board
+bool readRecord(Reader &in, const Board &board, Tetromino &piece, Position &pos,
+                InputPath &path) {
+    std::uint64_t value = in.varint();
+    unsigned flags = static_cast<unsigned>(value) & ((1u << FLAG_BITS) - 1);
+    value >>= FLAG_BITS;
+    auto type = static_cast<int>(value % NUM_TETROMINO_TYPES);
+    value /= NUM_TETROMINO_TYPES;
+    auto rotation = static_cast<int>(value % NUM_ROTATIONS);
+    value /= NUM_ROTATIONS;
+    if (value > 2 * X_BIAS + BOARD_WIDTH) {
+        return false;
+    }
+    piece = Tetromino(static_cast<TetrominoType>(type), rotation);
+    pos.x = static_cast<int>(value) - X_BIAS;
+    pos.y = (flags & FLAG_ROW) ? in.smallInt() - Y_BIAS : dropRow(board, piece, pos.x);
+
+    path.length = 0;
+    if (flags & FLAG_PATH) {
+        int length = in.smallInt();
+        if (length > InputPath::MAX_INPUTS) {
+            return false;
+        }
+        const std::uint8_t *inputs = in.nibbles(length);
+        for (int i = 0; in.ok && i < length; i++) {
+            unsigned input = in.nibble(i, inputs);
+            if (input > static_cast<unsigned>(Input::DROP)) {
+                return false;
+            }
+            path.inputs[static_cast<std::size_t>(i)] = static_cast<Input>(input);
+        }
+        path.length = length;
+    }
+    return in.ok && board.canPlace(piece, pos);
+}
+
+// Lock a decoded piece into a replayed board and count the score
+void applyRecord(ReplayState &state, const Tetromino &piece, Position pos) {
+    state.board.place(piece, pos);
+    int cleared = state.board.clearLines();
+    if (cleared > 0) {
+        state.lines += cleared;
+        state.score += lineClearScore(cleared, state.level);
+        state.level = 1 + state.lines / 10;
+    }
+    state.piece++;
+}
+
+} // namespace
+
+ReplayRecorder::ReplayRecorder(std::uint64_t seed, RandomizerKind kind, int keyframe_interval)
+    : seed_(seed), kind_(kind),
+      keyframe_interval_(std::clamp(keyframe_interval, 1, 0xFFFF)), pieces_(0) {}
+
+void ReplayRecorder::recordLock(const Game &game, const Input *path, int path_length) {
+    if (pieces_ % keyframe_interval_ == 0) {
+        keyframes_.push_back(stream_.size());
+        writeKeyframe(stream_, game);
+    }
+
+    const Board &board = game.getBoard();
+    const Tetromino &piece = game.getCurrentPiece();
+    Position pos = game.getCurrentPosition();
+    unsigned flags = 0;
+    if (dropRow(board, piece, pos.x) != pos.y) {
+        flags |= FLAG_ROW;
+    }
+    path_length = std::min(path_length, InputPath::MAX_INPUTS);
+    if (path != nullptr && path_length > 0) {
+        flags |= FLAG_PATH;
+    }
+
+    std::uint64_t value =
+        static_cast<std::uint64_t>(pos.x + X_BIAS) * NUM_ROTATIONS +
+        static_cast<std::uint64_t>(piece.getRotation());
+    value = value * NUM_TETROMINO_TYPES + static_cast<std::uint64_t>(piece.getType());
+    putVarint(stream_, value << FLAG_BITS | flags);
+    if (flags & FLAG_ROW) {
+        putVarint(stream_, static_cast<std::uint64_t>(pos.y + Y_BIAS));
+    }
+    if (flags & FLAG_PATH) {
+        putVarint(stream_, static_cast<std::uint64_t>(path_length));
+        putNibbles(stream_, path_length, [&](int i) { return static_cast<unsigned>(path[i]); });
+    }
+    pieces_++;
+}
+
+bool ReplayRecorder::save(const std::string &path, const Game &game) const {
+    // The board after a piece count on a keyframe boundary would otherwise
+    // be a whole interval of pieces away from the last keyframe
+    std::vector<std::uint64_t> offsets = keyframes_;
+    std::vector<std::uint8_t> closing;
+    if (pieces_ % keyframe_interval_ == 0) {
+        offsets.push_back(stream_.size());
+        writeKeyframe(closing, game);
+    }
+
+    std::vector<std::uint8_t> header(MAGIC, MAGIC + sizeof(MAGIC));
+    header.push_back(VERSION);
+    header.push_back(static_cast<std::uint8_t>(kind_));
+    putFixed(header, static_cast<std::uint64_t>(keyframe_interval_), 2);
+    putFixed(header, seed_, 8);
+    putFixed(header, static_cast<std::uint64_t>(pieces_), 4);
+    putFixed(header, offsets.size(), 4);
+    putFixed(header, HEADER_SIZE + stream_.size() + closing.size(), 8);
+    putFixed(header, static_cast<std::uint32_t>(game.getScore()), 4);
+    putFixed(header, static_cast<std::uint32_t>(game.getLinesCleared()), 4);
+    header.resize(HEADER_SIZE, 0);
+
+    std::vector<std::uint8_t> index;
+    for (std::uint64_t offset : offsets) {
+        putFixed(index, HEADER_SIZE + offset, 8);
+    }
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        const std::vector<std::uint8_t> *parts[] = {&header, &stream_, &closing, &index};
+        for (const std::vector<std::uint8_t> *part : parts) {
+            out.write(reinterpret_cast<const char *>(part->data()),
+                      static_cast<std::streamsize>(part->size()));
+        }
+        if (!out.flush()) {
+            return false;
+        }
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+ReplayFile::~ReplayFile() { close(); }
+
+bool ReplayFile::open(const std::string &path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info {};
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) >= HEADER_SIZE) {
+        mapping = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE,
+                       fd, 0);
+    }
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    data_ = static_cast<const std::uint8_t *>(mapping);
+    size_ = static_cast<std::size_t>(info.st_size);
+
+    kind_ = static_cast<RandomizerKind>(data_[5]);
+    keyframe_interval_ = static_cast<int>(getFixed(data_ + 6, 2));
+    seed_ = getFixed(data_ + 8, 8);
+    auto pieces = getFixed(data_ + 16, 4);
+    auto keyframes = getFixed(data_ + 20, 4);
+    std::uint64_t index_offset = getFixed(data_ + 24, 8);
+    score_ = static_cast<int>(static_cast<std::int32_t>(getFixed(data_ + 32, 4)));
+    lines_ = static_cast<int>(static_cast<std::int32_t>(getFixed(data_ + 36, 4)));
+
+    bool valid = std::memcmp(data_, MAGIC, sizeof(MAGIC)) == 0 && data_[4] == VERSION &&
+                 data_[5] <= static_cast<std::uint8_t>(RandomizerKind::BAG) &&
+                 keyframe_interval_ > 0 &&
+                 pieces <= static_cast<std::uint64_t>(std::numeric_limits<int>::max()) &&
+                 keyframes == pieces / static_cast<std::uint64_t>(keyframe_interval_) + 1 &&
+                 index_offset >= HEADER_SIZE && index_offset <= size_ &&
+                 (size_ - index_offset) / 8 == keyframes && (size_ - index_offset) % 8 == 0;
+    if (!valid) {
+        close();
+        return false;
+    }
+    pieces_ = static_cast<int>(pieces);
+    keyframes_ = static_cast<int>(keyframes);
+    index_ = data_ + index_offset;
+    for (int k = 0; k < keyframes_; k++) {
+        std::uint64_t offset = keyframeOffset(k);
+        if (offset < HEADER_SIZE || offset >= index_offset) {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void ReplayFile::close() {
+    if (data_ != nullptr) {
+        munmap(const_cast<std::uint8_t *>(data_), size_);
+    }
+    data_ = nullptr;
+    index_ = nullptr;
+    size_ = 0;
+    pieces_ = 0;
+    keyframes_ = 0;
+}
+
+std::uint64_t ReplayFile::keyframeOffset(int keyframe) const {
+    return getFixed(index_ + 8 * static_cast<std::size_t>(keyframe), 8);
+}
+
+bool ReplayFile::seek(int piece, ReplayState &state) const {
+    if (data_ == nullptr || piece < 0 || piece > pieces_) {
+        return false;
+    }
+    state.board.reset();
+    state.piece = 0;
+    state.score = 0;
+    state.lines = 0;
+    state.has_next = false;
+    state.next_path.length = 0;
+
+    // Start from the last keyframe at or before the piece
+    int keyframe = piece / keyframe_interval_;
+    Reader in{data_ + keyframeOffset(keyframe), index_};
+    Cells cells;
+    if (!readKeyframe(in, cells, state.score, state.lines)) {
+        return false;
+    }
+    state.board.loadCells(cells);
+    state.piece = keyframe * keyframe_interval_;
+    state.level = 1 + state.lines / 10;
+
+    Tetromino next(TetrominoType::I);
+    Position pos{};
+    InputPath path;
+    while (state.piece < piece) {
+        if (!readRecord(in, state.board, next, pos, path)) {
+            return false;
+        }
+        applyRecord(state, next, pos);
+    }
+    if (state.piece < pieces_) {
+        if (!readRecord(in, state.board, state.next, state.next_pos, state.next_path)) {
+            return false;
+        }
+        state.has_next = true;
+    }
+    return true;
+}
+
+ReplayCheck ReplayFile::verify() const {
+    ReplayCheck check{false, 0, 0, 0};
+    if (data_ == nullptr) {
+        return check;
+    }
+    Game game(seed_, kind_);
+    Reader in{data_ + HEADER_SIZE, index_};
+    Cells cells;
+    Tetromino piece(TetrominoType::I);
+    Position pos{};
+    InputPath path;
+    // The next keyframe in the stream holds the game as re-simulated so far
+    auto keyframeMatches = [&] {
+        int score = 0;
+        int lines = 0;
+        if (!readKeyframe(in, cells, score, lines) || score != game.getScore() ||
+            lines != game.getLinesCleared()) {
+            return false;
+        }
+        for (int y = 0; y < BOARD_HEIGHT; y++) {
+            for (int x = 0; x < BOARD_WIDTH; x++) {
+                if (cells[static_cast<std::size_t>(y)][static_cast<std::size_t>(x)] !=
+                    game.getBoard().getCell(x, y)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+    for (int i = 0; i < pieces_; i++, check.pieces++) {
+        if (i % keyframe_interval_ == 0 && !keyframeMatches()) {
+            return check;
+        }
+        if (!readRecord(in, game.getBoard(), piece, pos, path) ||
+            piece.getType() != game.getCurrentPiece().getType() ||
+            !game.applyPlacement(piece.getRotation(), pos)) {
+            return check;
+        }
+        check.score = game.getScore();
+        check.lines = game.getLinesCleared();
+    }
+    if (pieces_ % keyframe_interval_ == 0 && !keyframeMatches()) {
+        return check;
+    }
+    check.ok = in.pos == in.end && check.score == score_ && check.lines == lines_;
+    return check;
+}
+
+} // namespace tetris
@@ -1,24 +1,70 @@
+#include <tetris/profiler.hpp>
 #include <tetris/renderer.hpp>
 
 #include <algorithm>
+#include <cstdio>
 
 namespace tetris {
 
 // Minimum dimensions for a reasonable display
 constexpr int MIN_BOARD_HEIGHT = 10;
 constexpr int INFO_PANEL_WIDTH = 20;
+constexpr int SINGLE_INFO_WIDTH = 30;
+constexpr int LEADERBOARD_WIDTH = 30;
+// Title, header, LEADERBOARD_SIZE rows, totals and borders
+constexpr int LEADERBOARD_HEIGHT = LEADERBOARD_SIZE + 11;
 // Row height includes: board height + 2 (borders) + 1 (spacing between rows)
 constexpr int ROW_HEIGHT_OVERHEAD = 3;
 
+namespace {
+
+template <typename... Args> std::string formatLine(const char *format, Args... args) {
+    char buffer[128];
+    std::snprintf(buffer, sizeof(buffer), format, args...);
+    return buffer;
+}
+
+// p50/p99 of every probe that has seen calls, in microseconds
+std::string formatLatencies() {
+    std::string line = "Latency p50/p99 us:";
+    for (int i = 0; i < NUM_PROBES; i++) {
+        auto probe = static_cast<Probe>(i);
+        const LatencyHistogram &histogram = probeHistogram(probe);
+        if (histogram.getCount() > 0) {
+            double p50 = static_cast<double>(histogram.getPercentile(50.0)) / 1000.0;
+            double p99 = static_cast<double>(histogram.getPercentile(99.0)) / 1000.0;
+            line += formatLine("  %s %.1f/%.1f", probeName(probe), p50, p99);
+        }
+    }
+    return line;
+}
+
+// Columns, up to limit, where text differs from the shown line. Past the
+// end of either line the column is blank.
+std::size_t changedCells(const std::string &shown, const std::string &text,
+                         std::size_t limit) {
+    std::size_t width = std::min(std::max(shown.size(), text.size()), limit);
+    std::size_t changed = 0;
+    for (std::size_t i = 0; i < width; i++) {
+        char before = i < shown.size() ? shown[i] : ' ';
+        char after = i < text.size() ? text[i] : ' ';
+        changed += before != after ? 1 : 0;
+    }
+    return changed;
+}
+
+} // namespace
+
 Renderer::Renderer()
-    : game_win_(nullptr), info_win_(nullptr), board_height_(BOARD_HEIGHT),
-      board_width_(BOARD_WIDTH), term_height_(0), term_width_(0),
-      last_num_players_(0), cached_layout_{0, 0, 0} {}
+    : board_height_(BOARD_HEIGHT), board_width_(BOARD_WIDTH), term_height_(0),
+      term_width_(0), last_num_boards_(0), cached_layout_{0, 0, 0}, active_(false),
+      frame_bytes_(0), last_frame_bytes_(0) {}
 
 Renderer::~Renderer() { cleanup(); }
 
 void Renderer::init() {
     initscr();
+    active_ = true;
     start_color();
     cbreak();
     noecho();
@@ -41,8 +87,9 @@ void Renderer::init() {
     // Create windows with calculated dimensions
     int win_height = board_height_ + 2;
     int win_width = board_width_ * 2 + 2;
-    game_win_ = newwin(win_height, win_width, 1, 2);
-    info_win_ = newwin(win_height, 30, 1, win_width + 4);
+    single_view_.game_win = newwin(win_height, win_width, 1, 2);
+    single_view_.info_win = newwin(win_height, SINGLE_INFO_WIDTH, 1, win_width + 4);
+    single_view_.info_width = SINGLE_INFO_WIDTH;
 }
 
 void Renderer::updateTerminalSize() {
@@ -64,21 +111,16 @@ void Renderer::updateTerminalSize() {
 }
 
 void Renderer::cleanup() {
-    if (game_win_)
-        delwin(game_win_);
-    if (info_win_)
-        delwin(info_win_);
-    for (auto win : mp_game_wins_) {
-        if (win)
-            delwin(win);
-    }
-    for (auto win : mp_info_wins_) {
-        if (win)
-            delwin(win);
-    }
-    mp_game_wins_.clear();
-    mp_info_wins_.clear();
+    if (!active_)
+        return;
+    if (single_view_.game_win)
+        delwin(single_view_.game_win);
+    if (single_view_.info_win)
+        delwin(single_view_.info_win);
+    single_view_ = PanelView{};
+    destroyMultiPlayerWindows();
     endwin();
+    active_ = false;
 }
 
 void Renderer::drawBorder(WINDOW *win, int height, int width) {
@@ -89,159 +131,249 @@ void Renderer::drawBorder(WINDOW *win, int height, int width) {
 }
 
 void Renderer::drawBlock(WINDOW *win, int x, int y, int color) {
+    frame_bytes_ += 2;
     if (color > 0) {
         wattron(win, COLOR_PAIR(color));
         mvwaddstr(win, y + 1, x * 2 + 1, "  ");
         wattroff(win, COLOR_PAIR(color));
+    } else {
+        mvwaddstr(win, y + 1, x * 2 + 1, "  ");
     }
 }
 
-void Renderer::render(const Game &game) {
-    werase(game_win_);
-    werase(info_win_);
-
-    int win_height = board_height_ + 2;
-    int win_width = board_width_ * 2 + 2;
-    
-    drawBorder(game_win_, win_height, win_width);
-    drawBorder(info_win_, win_height, 30);
+void Renderer::prepareView(PanelView &view) {
+    if (!view.stale) {
+        return;
+    }
+    // Start from blank windows and a shadow that matches nothing
+    if (view.game_win != nullptr) {
+        werase(view.game_win);
+        drawBorder(view.game_win, board_height_ + 2, board_width_ * 2 + 2);
+        frame_bytes_ += static_cast<std::size_t>(2 * (board_height_ + 2) +
+                                                 2 * (board_width_ * 2 + 2));
+    }
+    werase(view.info_win);
+    drawBorder(view.info_win, getmaxy(view.info_win), view.info_width);
+    frame_bytes_ += static_cast<std::size_t>(2 * getmaxy(view.info_win) + 2 * view.info_width);
+    view.cells.fill(PanelView::UNKNOWN_CELL);
+    view.info_lines.clear();
+    view.showing_game_over = false;
+    view.stale = false;
+}
 
-    // Draw board
-    const Board &board = game.getBoard();
+void Renderer::drawBoard(PanelView &view, const GameSnapshot &game, bool show_piece) {
     // Only draw the visible portion of the board based on board_height_
-    int start_y = board.getHeight() > board_height_ ? board.getHeight() - board_height_ : 0;
-    for (int y = start_y; y < board.getHeight(); y++) {
-        for (int x = 0; x < board.getWidth(); x++) {
-            int cell = board.getCell(x, y);
-            if (cell > 0) {
-                drawBlock(game_win_, x, y - start_y, cell);
+    int start_y = BOARD_HEIGHT > board_height_ ? BOARD_HEIGHT - board_height_ : 0;
+    int visible_rows = BOARD_HEIGHT - start_y;
+
+    std::array<std::uint8_t, BOARD_WIDTH * BOARD_HEIGHT> frame{};
+    for (int y = 0; y < visible_rows; y++) {
+        const auto &row = game.cells[static_cast<std::size_t>(y + start_y)];
+        std::copy(row.begin(), row.end(), frame.begin() + y * BOARD_WIDTH);
+    }
+
+    // Overlay the current piece
+    if (show_piece) {
+        Tetromino piece(game.piece, game.rotation);
+        Position pos = game.pos;
+        auto color = static_cast<std::uint8_t>(static_cast<int>(piece.getType()) + 1);
+        for (const auto &block : piece.getBlocks()) {
+            int x = pos.x + block.x;
+            int y = pos.y + block.y;
+            if (y >= start_y && y < BOARD_HEIGHT && x >= 0 && x < BOARD_WIDTH) {
+                frame[static_cast<std::size_t>((y - start_y) * BOARD_WIDTH + x)] = color;
             }
         }
     }
 
-    // Draw current piece
-    const Tetromino &piece = game.getCurrentPiece();
-    Position pos = game.getCurrentPosition();
-    int color = static_cast<int>(piece.getType()) + 1;
-    for (const auto &block : piece.getBlocks()) {
-        int x = pos.x + block.x;
-        int y = pos.y + block.y;
-        if (y >= start_y && y < board.getHeight() && x >= 0 && x < board.getWidth()) {
-            drawBlock(game_win_, x, y - start_y, color);
+    // Send only the cells that differ from what is on screen
+    for (int y = 0; y < visible_rows; y++) {
+        for (int x = 0; x < BOARD_WIDTH; x++) {
+            auto index = static_cast<std::size_t>(y * BOARD_WIDTH + x);
+            if (frame[index] != view.cells[index]) {
+                drawBlock(view.game_win, x, y, frame[index]);
+                view.cells[index] = frame[index];
+            }
         }
     }
-
-    // Draw info
-    mvwprintw(info_win_, 2, 2, "TETRIS with AI");
-    mvwprintw(info_win_, 4, 2, "Score: %d", game.getScore());
-    mvwprintw(info_win_, 5, 2, "Level: %d", game.getLevel());
-    mvwprintw(info_win_, 6, 2, "Lines: %d", game.getLinesCleared());
-    mvwprintw(info_win_, 8, 2, "Controls:");
-    mvwprintw(info_win_, 9, 2, "  A - Auto play");
-    mvwprintw(info_win_, 10, 2, "  Arrow keys - Move");
-    mvwprintw(info_win_, 11, 2, "  Up - Rotate");
-    mvwprintw(info_win_, 12, 2, "  Space - Drop");
-    mvwprintw(info_win_, 13, 2, "  R - Reset");
-    mvwprintw(info_win_, 14, 2, "  Q - Quit");
-
-    wrefresh(game_win_);
-    wrefresh(info_win_);
-    refresh();
 }
 
-void Renderer::renderGameOver(const Game &game) {
-    werase(game_win_);
-    int win_height = board_height_ + 2;
-    int win_width = board_width_ * 2 + 2;
-    drawBorder(game_win_, win_height, win_width);
-
-    mvwprintw(game_win_, board_height_ / 2 - 1, board_width_ - 4, "GAME OVER");
-    mvwprintw(game_win_, board_height_ / 2 + 1, board_width_ - 6,
-              "Score: %d", game.getScore());
-    mvwprintw(game_win_, board_height_ / 2 + 2, board_width_ - 8,
-              "Press R to restart");
+void Renderer::drawInfoLine(PanelView &view, int row, int col, const std::string &text) {
+    if (row >= getmaxy(view.info_win) - 1) {
+        // Would land on the bottom border or below the window
+        return;
+    }
+    auto index = static_cast<std::size_t>(row);
+    if (view.info_lines.size() <= index) {
+        view.info_lines.resize(index + 1);
+    }
+    std::string &shown = view.info_lines[index];
+    if (shown == text) {
+        return;
+    }
+    // Pad with spaces to wipe the rest of a longer old line, keeping the border
+    std::string padded = text;
+    if (padded.size() < shown.size()) {
+        padded.resize(shown.size(), ' ');
+    }
+    int room = std::max(0, view.info_width - 1 - col);
+    mvwaddnstr(view.info_win, row, col, padded.c_str(), room);
+    frame_bytes_ += changedCells(shown, text, static_cast<std::size_t>(room));
+    shown = text;
+}
 
-    wrefresh(game_win_);
+void Renderer::drawStatusLine(std::size_t index, int y, const std::string &text) {
+    std::string &shown = status_lines_[index];
+    if (shown == text) {
+        return;
+    }
+    move(y, 0);
+    clrtoeol();
+    mvaddstr(y, 2, text.c_str());
+    // curses only sends the columns that changed, not the whole line
+    auto room = static_cast<std::size_t>(std::max(term_width_ - 2, 0));
+    frame_bytes_ += changedCells(shown, text, room);
+    shown = text;
 }
 
-void Renderer::renderSingleGame(WINDOW *game_win, WINDOW *info_win,
-                                 const Game &game, int player_id) {
-    werase(game_win);
-    werase(info_win);
+void Renderer::finishFrame() {
+    doupdate();
+    last_frame_bytes_ = frame_bytes_;
+    frame_bytes_ = 0;
+}
 
-    int win_height = board_height_ + 2;
-    int win_width = board_width_ * 2 + 2;
+void Renderer::render(const GameSnapshot &game) {
+    TETRIS_PROFILE_SCOPE(Probe::RENDER);
+    PanelView &view = single_view_;
+    prepareView(view);
+    if (view.showing_game_over) {
+        // The game over text covers the board, repaint every cell
+        view.cells.fill(PanelView::UNKNOWN_CELL);
+        view.showing_game_over = false;
+    }
 
-    drawBorder(game_win, win_height, win_width);
-    drawBorder(info_win, win_height, INFO_PANEL_WIDTH);
+    drawBoard(view, game, true);
 
-    const Board &board = game.getBoard();
-    int start_y =
-        board.getHeight() > board_height_ ? board.getHeight() - board_height_ : 0;
+    // Draw info
+    drawInfoLine(view, 2, 2, "TETRIS with AI");
+    drawInfoLine(view, 4, 2, formatLine("Score: %d", game.score));
+    drawInfoLine(view, 5, 2, formatLine("Level: %d", game.level));
+    drawInfoLine(view, 6, 2, formatLine("Lines: %d", game.lines));
+    drawInfoLine(view, 8, 2, "Controls:");
+    drawInfoLine(view, 9, 2, "  A - Auto play");
+    drawInfoLine(view, 10, 2, "  Arrow keys - Move");
+    drawInfoLine(view, 11, 2, "  Up - Rotate");
+    drawInfoLine(view, 12, 2, "  Space - Drop");
+    drawInfoLine(view, 13, 2, "  R - Reset");
+    drawInfoLine(view, 14, 2, "  Q - Quit");
+    drawInfoLine(view, 16, 2, formatLine("Output: %zu B/frame", last_frame_bytes_));
+
+    // Latencies go under the board, the panel has no room for them
+    if (PROFILING_ENABLED && board_height_ + 3 < term_height_) {
+        drawStatusLine(2, board_height_ + 3, formatLatencies());
+        wnoutrefresh(stdscr);
+    }
+    wnoutrefresh(view.game_win);
+    wnoutrefresh(view.info_win);
+    finishFrame();
+}
 
-    // Draw board
-    for (int y = start_y; y < board.getHeight(); y++) {
-        for (int x = 0; x < board.getWidth(); x++) {
-            int cell = board.getCell(x, y);
-            if (cell > 0) {
-                drawBlock(game_win, x, y - start_y, cell);
-            }
-        }
+void Renderer::renderGameOver(const GameSnapshot &game) {
+    PanelView &view = single_view_;
+    prepareView(view);
+    if (!view.showing_game_over) {
+        // The message stays put until the next render(), draw it once
+        werase(view.game_win);
+        frame_bytes_ += static_cast<std::size_t>((board_height_ + 2) * (board_width_ * 2 + 2));
+        drawBorder(view.game_win, board_height_ + 2, board_width_ * 2 + 2);
+        mvwprintw(view.game_win, board_height_ / 2 - 1, board_width_ - 4, "GAME OVER");
+        mvwprintw(view.game_win, board_height_ / 2 + 1, board_width_ - 6, "Score: %d",
+                  game.score);
+        mvwprintw(view.game_win, board_height_ / 2 + 2, board_width_ - 8,
+                  "Press R to restart");
+        view.showing_game_over = true;
     }
 
+    wnoutrefresh(view.game_win);
+    finishFrame();
+}
+
+void Renderer::renderSingleGame(PanelView &view, const GameSnapshot &game, int player_id,
+                                int rank) {
+    prepareView(view);
+
     // Draw current piece if game is still playing
-    if (game.getState() == GameState::PLAYING) {
-        const Tetromino &piece = game.getCurrentPiece();
-        Position pos = game.getCurrentPosition();
-        int color = static_cast<int>(piece.getType()) + 1;
-        for (const auto &block : piece.getBlocks()) {
-            int x = pos.x + block.x;
-            int y = pos.y + block.y;
-            if (y >= start_y && y < board.getHeight() && x >= 0 &&
-                x < board.getWidth()) {
-                drawBlock(game_win, x, y - start_y, color);
-            }
-        }
-    }
+    bool playing = game.state == GameState::PLAYING;
+    drawBoard(view, game, playing);
 
     // Draw info
-    mvwprintw(info_win, 1, 1, "Player %d", player_id + 1);
-    mvwprintw(info_win, 3, 1, "Score: %d", game.getScore());
-    mvwprintw(info_win, 4, 1, "Level: %d", game.getLevel());
-    mvwprintw(info_win, 5, 1, "Lines: %d", game.getLinesCleared());
+    drawInfoLine(view, 1, 1, formatLine("Player %d", player_id + 1));
+    drawInfoLine(view, 2, 1, rank >= 0 ? formatLine("Rank #%d", rank + 1) : "");
+    drawInfoLine(view, 3, 1, formatLine("Score: %d", game.score));
+    drawInfoLine(view, 4, 1, formatLine("Level: %d", game.level));
+    drawInfoLine(view, 5, 1, formatLine("Lines: %d", game.lines));
+    drawInfoLine(view, 7, 1, playing ? "" : "GAME OVER");
+
+    wnoutrefresh(view.game_win);
+    wnoutrefresh(view.info_win);
+}
 
-    if (game.getState() == GameState::GAME_OVER) {
-        mvwprintw(info_win, 7, 1, "GAME OVER");
+void Renderer::renderLeaderboard(const LeagueFrame &frame) {
+    PanelView &view = leaderboard_view_;
+    prepareView(view);
+
+    drawInfoLine(view, 1, 1, "Leaderboard");
+    drawInfoLine(view, 2, 1, "   # Player     Score Lines");
+    for (int i = 0; i < LEADERBOARD_SIZE; i++) {
+        if (i < frame.num_leaders) {
+            const PlayerStanding &leader = frame.leaders[static_cast<std::size_t>(i)];
+            drawInfoLine(view, 3 + i, 1,
+                         formatLine("%4d %6d %9d %5d%s", i + 1, leader.player + 1, leader.score,
+                                    leader.lines, leader.state == GameState::PLAYING ? "" : "x"));
+        } else {
+            drawInfoLine(view, 3 + i, 1, "");
+        }
     }
 
-    wrefresh(game_win);
-    wrefresh(info_win);
+    int row = 4 + LEADERBOARD_SIZE;
+    drawInfoLine(view, row++, 1, formatLine("Players: %d", frame.num_players));
+    drawInfoLine(view, row++, 1, formatLine("Playing: %d", frame.active_players));
+    drawInfoLine(view, row++, 1,
+                 formatLine("Total lines: %lld", static_cast<long long>(frame.total_lines)));
+    const char *order = frame.page.order == PageOrder::RANK ? "ranks" : "players";
+    drawInfoLine(view, row++, 1,
+                 frame.num_boards > 0
+                     ? formatLine("Showing %s %d-%d", order, frame.page.first + 1,
+                                  frame.page.first + frame.num_boards)
+                     : "");
+
+    wnoutrefresh(view.info_win);
 }
 
-LayoutInfo Renderer::calculateLayout(int num_players) const {
+LayoutInfo Renderer::calculateLayout(int num_boards) const {
     LayoutInfo layout;
 
-    // Calculate how many players can fit per row
-    // Each player needs: board_width * 2 + 2 (game) + INFO_PANEL_WIDTH (info) +
+    // Calculate how many boards can fit per row
+    // Each board needs: board_width * 2 + 2 (game) + INFO_PANEL_WIDTH (info) +
     // 2 (spacing)
     int player_width = board_width_ * 2 + 2 + INFO_PANEL_WIDTH + 2;
 
-    // Leave some margin on the sides
-    int available_width = term_width_ - 4;
+    // Leave some margin on the sides and room for the leaderboard
+    int available_width = term_width_ - 4 - (LEADERBOARD_WIDTH + 2);
     layout.cols = std::max(1, available_width / player_width);
 
-    // Don't use more columns than players
-    layout.cols = std::min(layout.cols, num_players);
+    // Don't use more columns than boards
+    layout.cols = std::max(1, std::min(layout.cols, num_boards));
 
     // Calculate rows needed
-    layout.rows = (num_players + layout.cols - 1) / layout.cols;
+    layout.rows = std::max(1, (num_boards + layout.cols - 1) / layout.cols);
 
     // Calculate the height available for each row
     // Reserve: 1 for top margin, 2 for control info at bottom
     int available_height = term_height_ - ROW_HEIGHT_OVERHEAD;
     int height_per_row = available_height / layout.rows;
 
-    // Each player needs: board height + ROW_HEIGHT_OVERHEAD (2 borders + 1 row spacing)
+    // Each board needs: board height + ROW_HEIGHT_OVERHEAD (2 borders + 1 row spacing)
     layout.player_board_height = height_per_row - ROW_HEIGHT_OVERHEAD;
     layout.player_board_height =
         std::clamp(layout.player_board_height, MIN_BOARD_HEIGHT, BOARD_HEIGHT);
@@ -249,21 +381,35 @@ LayoutInfo Renderer::calculateLayout(int num_players) const {
     return layout;
 }
 
-void Renderer::recreateMultiPlayerWindows(int num_players) {
-    // Clear old windows
-    for (auto win : mp_game_wins_) {
-        if (win)
-            delwin(win);
-    }
-    for (auto win : mp_info_wins_) {
-        if (win)
-            delwin(win);
+int Renderer::getPageCapacity() const {
+    int height, width;
+    getmaxyx(stdscr, height, width);
+    int player_width = BOARD_WIDTH * 2 + 2 + INFO_PANEL_WIDTH + 2;
+    int cols = std::max(1, (width - 4 - (LEADERBOARD_WIDTH + 2)) / player_width);
+    int rows = std::max(1, (height - ROW_HEIGHT_OVERHEAD) /
+                               (MIN_BOARD_HEIGHT + ROW_HEIGHT_OVERHEAD));
+    return std::min(cols * rows, MAX_PAGE_BOARDS);
+}
+
+void Renderer::destroyMultiPlayerWindows() {
+    for (auto &view : mp_views_) {
+        if (view.game_win)
+            delwin(view.game_win);
+        if (view.info_win)
+            delwin(view.info_win);
     }
-    mp_game_wins_.clear();
-    mp_info_wins_.clear();
+    mp_views_.clear();
+    if (leaderboard_view_.info_win)
+        delwin(leaderboard_view_.info_win);
+    leaderboard_view_ = PanelView{};
+}
+
+void Renderer::recreateMultiPlayerWindows(int num_boards) {
+    // Clear old windows
+    destroyMultiPlayerWindows();
 
     // Calculate and cache layout
-    cached_layout_ = calculateLayout(num_players);
+    cached_layout_ = calculateLayout(num_boards);
 
     // Update board height for rendering
     board_height_ = cached_layout_.player_board_height;
@@ -273,9 +419,8 @@ void Renderer::recreateMultiPlayerWindows(int num_players) {
     int player_width = win_width + INFO_PANEL_WIDTH + 2;
     int row_height = win_height + 1;
 
-    // Create windows for each player
-    // Note: Windows that don't fit on screen are set to nullptr and skipped during rendering
-    for (int i = 0; i < num_players; i++) {
+    mp_views_.resize(static_cast<std::size_t>(num_boards));
+    for (int i = 0; i < num_boards; i++) {
         int col = i % cached_layout_.cols;
         int row = i / cached_layout_.cols;
 
@@ -284,21 +429,33 @@ void Renderer::recreateMultiPlayerWindows(int num_players) {
 
         // Check if window would be visible
         if (x_offset + win_width <= term_width_ && y_offset + win_height <= term_height_) {
-            mp_game_wins_.push_back(newwin(win_height, win_width, y_offset, x_offset));
-            mp_info_wins_.push_back(
-                newwin(win_height, INFO_PANEL_WIDTH, y_offset, x_offset + win_width + 2));
-        } else {
-            // Window doesn't fit - mark as nullptr to skip during rendering
-            mp_game_wins_.push_back(nullptr);
-            mp_info_wins_.push_back(nullptr);
+            PanelView &view = mp_views_[static_cast<std::size_t>(i)];
+            view.game_win = newwin(win_height, win_width, y_offset, x_offset);
+            view.info_win =
+                newwin(win_height, INFO_PANEL_WIDTH, y_offset, x_offset + win_width + 2);
+            view.info_width = INFO_PANEL_WIDTH;
         }
     }
 
-    last_num_players_ = num_players;
+    // The leaderboard goes right of the boards, as tall as they are
+    int board_area_height = cached_layout_.rows * row_height - 1;
+    int leaderboard_x = 2 + cached_layout_.cols * player_width + 2;
+    int leaderboard_height = std::min(LEADERBOARD_HEIGHT, std::max(board_area_height, 3));
+    if (leaderboard_x + LEADERBOARD_WIDTH <= term_width_ &&
+        1 + leaderboard_height <= term_height_) {
+        leaderboard_view_.info_win =
+            newwin(leaderboard_height, LEADERBOARD_WIDTH, 1, leaderboard_x);
+        leaderboard_view_.info_width = LEADERBOARD_WIDTH;
+    }
+
+    // The status lines may have moved
+    status_lines_ = {};
+    last_num_boards_ = num_boards;
 }
 
-void Renderer::renderMultiPlayer(const MultiPlayerGame &mp_game) {
-    int num_players = mp_game.getNumPlayers();
+void Renderer::renderMultiPlayer(const LeagueFrame &frame) {
+    TETRIS_PROFILE_SCOPE(Probe::RENDER);
+    int num_boards = frame.num_boards;
 
     // Check for terminal resize
     int new_height, new_width;
@@ -312,47 +469,55 @@ void Renderer::renderMultiPlayer(const MultiPlayerGame &mp_game) {
     }
 
     // Check if we need to recreate windows
-    bool needs_recreate = (mp_game_wins_.size() != static_cast<size_t>(num_players)) ||
-                          (last_num_players_ != num_players) ||
-                          terminal_resized;
+    bool needs_recreate = (mp_views_.size() != static_cast<size_t>(num_boards)) ||
+                          (last_num_boards_ != num_boards) || terminal_resized;
 
     if (needs_recreate) {
-        recreateMultiPlayerWindows(num_players);
-    }
-
-    // Render each player's game
-    for (int i = 0; i < num_players; i++) {
-        size_t idx = static_cast<size_t>(i);
-        if (mp_game_wins_[idx] != nullptr && mp_info_wins_[idx] != nullptr) {
-            renderSingleGame(mp_game_wins_[idx], mp_info_wins_[idx],
-                             mp_game.getGame(i), i);
-        }
+        recreateMultiPlayerWindows(num_boards);
     }
 
     // Use cached layout for status bar position
     int row_height = cached_layout_.player_board_height + ROW_HEIGHT_OVERHEAD;
 
-    // Draw control info at the bottom
+    // Draw control info at the bottom. stdscr goes out first, the player
+    // windows are layered on top of it.
     int info_y = 1 + cached_layout_.rows * row_height;
     if (info_y < term_height_ - 1) {
-        // Clear the info line area first
-        move(info_y, 0);
-        clrtoeol();
-        move(info_y + 1, 0);
-        clrtoeol();
-
-        mvprintw(info_y, 2, "Controls: R - Reset | Q - Quit | Terminal: %dx%d",
-                 term_width_, term_height_);
-        if (!mp_game.isAnyPlaying()) {
-            mvprintw(info_y + 1, 2, "All games finished! Press R to restart.");
+        drawStatusLine(0, info_y,
+                       formatLine("Controls: R - Reset | Q - Quit | [ ] - Page | V - Order | "
+                                  "Terminal: %dx%d | Output: %zu B/frame",
+                                  term_width_, term_height_, last_frame_bytes_));
+        int page_size = std::max(frame.page.size, 1);
+        if (frame.active_players == 0) {
+            drawStatusLine(1, info_y + 1, "All games finished! Press R to restart.");
         } else {
-            mvprintw(info_y + 1, 2, "Active players: %d/%d  Layout: %dx%d",
-                     mp_game.getActivePlayers(), num_players,
-                     cached_layout_.cols, cached_layout_.rows);
+            drawStatusLine(1, info_y + 1,
+                           formatLine("Active players: %d/%d  Page: %d/%d  Layout: %dx%d",
+                                      frame.active_players, frame.num_players,
+                                      frame.page.first / page_size + 1,
+                                      (frame.num_players + page_size - 1) / page_size,
+                                      cached_layout_.cols, cached_layout_.rows));
         }
+        if (PROFILING_ENABLED && info_y + 2 < term_height_) {
+            drawStatusLine(2, info_y + 2, formatLatencies());
+        }
+    }
+    wnoutrefresh(stdscr);
+
+    // Render the boards on the page, nobody else's
+    for (int i = 0; i < num_boards; i++) {
+        PanelView &view = mp_views_[static_cast<std::size_t>(i)];
+        if (view.game_win != nullptr && view.info_win != nullptr) {
+            auto slot = static_cast<std::size_t>(i);
+            renderSingleGame(view, frame.boards[slot], frame.board_players[slot],
+                             frame.board_ranks[slot]);
+        }
+    }
+    if (leaderboard_view_.info_win != nullptr) {
+        renderLeaderboard(frame);
     }
 
-    refresh();
+    finishFrame();
 }
 
 } // namespace tetris
@@ -0,0 +1,185 @@
+#include <tetris/ai.hpp>
+#include <tetris/recording.hpp>
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void printUsage(const char *program_name) {
+    std::cout << "Usage: " << program_name << " record FILE [options]\n";
+    std::cout << "       " << program_name << " verify FILE\n";
+    std::cout << "       " << program_name << " show FILE PIECE\n";
+    std::cout << "Records seeded AI games to compact replay files and plays them back.\n";
+    std::cout << "\nCommands:\n";
+    std::cout << "  record  Play one AI game and record every piece to FILE\n";
+    std::cout << "  verify  Re-simulate FILE from its seed and check the recorded score\n";
+    std::cout << "  show    Print the board just before piece PIECE (from 0) locks\n";
+    std::cout << "\nRecord options:\n";
+    std::cout << "  --seed S         Game seed (default: 1)\n";
+    std::cout << "  --max-pieces N   Stop after N pieces, 0 = play to top-out (default: 0)\n";
+    std::cout << "  --bag            Deal pieces from shuffled 7-bags instead of uniformly\n";
+    std::cout << "  --paths          Steer each piece with its inputs and record them\n";
+    std::cout << "  --keyframes N    Pieces between board keyframes (default: 64)\n";
+}
+
+double microseconds(Clock::duration elapsed) {
+    return std::chrono::duration<double, std::micro>(elapsed).count();
+}
+
+int record(const std::string &path, int argc, char *argv[]) {
+    std::uint64_t seed = 1;
+    int piece_cap = 0;
+    bool paths = false;
+    int keyframe_interval = tetris::DEFAULT_KEYFRAME_INTERVAL;
+    tetris::RandomizerKind kind = tetris::RandomizerKind::UNIFORM;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bag") {
+            kind = tetris::RandomizerKind::BAG;
+            continue;
+        }
+        if (arg == "--paths") {
+            paths = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Unknown option or missing value: " << arg << "\n";
+            return 1;
+        }
+        const char *value = argv[++i];
+        if (arg == "--seed") {
+            seed = std::strtoull(value, nullptr, 0);
+        } else if (arg == "--max-pieces") {
+            piece_cap = std::atoi(value);
+        } else if (arg == "--keyframes") {
+            keyframe_interval = std::atoi(value);
+        } else {
+            std::cerr << "Error: Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    tetris::Game game(seed, kind);
+    tetris::ReplayRecorder recorder(seed, kind, keyframe_interval);
+    game.setRecorder(&recorder);
+    tetris::AI ai;
+    while (game.getState() == tetris::GameState::PLAYING &&
+           (piece_cap <= 0 || recorder.getPieceCount() < piece_cap)) {
+        tetris::AI::Move move = ai.findBestMove(game);
+        if (paths && move.path.length > 0) {
+            game.applyPath(move.path);
+        } else if (!game.applyPlacement(move.rotation, {move.x, move.y})) {
+            game.drop();
+        }
+    }
+    game.setRecorder(nullptr);
+
+    if (!recorder.save(path, game)) {
+        std::cerr << "Error: Cannot write " << path << "\n";
+        return 1;
+    }
+    int pieces = recorder.getPieceCount();
+    fmt::print("Recorded {} pieces, score {}, lines {}\n", pieces, game.getScore(),
+               game.getLinesCleared());
+    fmt::print("Stream {} bytes, {:.2f} bytes per piece\n", recorder.getStreamBytes(),
+               pieces > 0 ? static_cast<double>(recorder.getStreamBytes()) / pieces : 0.0);
+    return 0;
+}
+
+int verify(const tetris::ReplayFile &replay) {
+    auto start = Clock::now();
+    tetris::ReplayCheck check = replay.verify();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    fmt::print("Seed {}, {} pieces, recorded score {}, lines {}\n", replay.getSeed(),
+               replay.getPieceCount(), replay.getRecordedScore(), replay.getRecordedLines());
+    fmt::print("Re-simulated {} pieces in {:.3f} ms ({:.0f} pieces/s)\n", check.pieces,
+               seconds * 1e3, seconds > 0 ? check.pieces / seconds : 0.0);
+    if (!check.ok) {
+        fmt::print("MISMATCH after piece {}: score {}, lines {}\n", check.pieces, check.score,
+                   check.lines);
+        return 1;
+    }
+    fmt::print("OK: score {}, lines {}\n", check.score, check.lines);
+    return 0;
+}
+
+int show(const tetris::ReplayFile &replay, int piece) {
+    tetris::ReplayState state;
+    auto start = Clock::now();
+    bool found = replay.seek(piece, state);
+    double elapsed = microseconds(Clock::now() - start);
+    if (!found) {
+        std::cerr << "Error: No piece " << piece << " in a replay of "
+                  << replay.getPieceCount() << " pieces\n";
+        return 1;
+    }
+
+    fmt::print("Piece {}/{}  Score: {}  Level: {}  Lines: {}  (seek {:.1f} us)\n", state.piece,
+               replay.getPieceCount(), state.score, state.level, state.lines, elapsed);
+    // The board, with the piece about to lock drawn as ##
+    tetris::Board board = state.board;
+    for (int y = 0; y < board.getHeight(); y++) {
+        std::string row = "|";
+        for (int x = 0; x < board.getWidth(); x++) {
+            bool next = false;
+            if (state.has_next) {
+                for (const auto &block : state.next.getBlocks()) {
+                    next = next || (state.next_pos.x + block.x == x &&
+                                    state.next_pos.y + block.y == y);
+                }
+            }
+            row += next ? "##" : board.getCell(x, y) != 0 ? "[]" : " .";
+        }
+        fmt::print("{}|\n", row);
+    }
+    if (state.has_next) {
+        fmt::print("Locks at x={} y={} rotation {}, {} recorded inputs\n", state.next_pos.x,
+                   state.next_pos.y, state.next.getRotation(), state.next_path.length);
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    if (argc >= 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
+        printUsage(argv[0]);
+        return 0;
+    }
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    std::string command = argv[1];
+    std::string path = argv[2];
+    if (command == "record") {
+        return record(path, argc - 3, argv + 3);
+    }
+
+    tetris::ReplayFile replay;
+    if (command != "verify" && command != "show") {
+        std::cerr << "Error: Unknown command: " << command << "\n";
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (!replay.open(path)) {
+        std::cerr << "Error: " << path << " is not a readable replay file\n";
+        return 1;
+    }
+    if (command == "verify") {
+        return verify(replay);
+    }
+    if (argc < 4) {
+        std::cerr << "Error: show needs a piece number\n";
+        return 1;
+    }
+    return show(replay, std::atoi(argv[3]));
+}
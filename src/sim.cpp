@@ -0,0 +1,181 @@
+#include <tetris/profiler.hpp>
+#include <tetris/simulation.hpp>
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+
+namespace {
+
+std::string formatBoardSizes() {
+    std::string sizes;
+    for (const auto &[width, height] : tetris::BOARD_SIZES) {
+        sizes += fmt::format("{}{}x{}", sizes.empty() ? "" : ", ", width, height);
+    }
+    return sizes;
+}
+
+void printUsage(const char *program_name) {
+    std::cout << "Usage: " << program_name << " [options]\n";
+    std::cout << "Plays seeded AI games headless, as fast as possible.\n";
+    std::cout << "\nOptions:\n";
+    std::cout << "  --games N       Number of games (default: 100)\n";
+    std::cout << "  --max-pieces N  Stop each game after N pieces, 0 = play to top-out\n";
+    std::cout << "                  (default: 0)\n";
+    std::cout << "  --seed S        Base seed (default: 1)\n";
+    std::cout << "  --threads N     Worker threads, 0 = all cores (default: 0)\n";
+    std::cout << "  --depth D       AI search depth (default: 1)\n";
+    std::cout << "  --beam W        AI beam width (default: 8)\n";
+    std::cout << "  --preview N     Preview queue size (default: 3)\n";
+    std::cout << "  --bag           Deal pieces from shuffled 7-bags instead of uniformly\n";
+    std::cout << "  --board WxH     Board size, one of " << formatBoardSizes()
+              << " (default: " << tetris::BOARD_WIDTH << "x" << tetris::BOARD_HEIGHT
+              << ")\n";
+    std::cout << "  --weights W     Evaluator weights lines,height,holes,bumpiness, as\n";
+    std::cout << "                  printed by tetris-tune (default: built-in weights)\n";
+    std::cout << "  --json          Print the report as JSON\n";
+    std::cout << "  --profile FILE  Write hot-path latencies to FILE, as CSV if it ends in\n";
+    std::cout << "                  .csv and JSON otherwise (needs -DTETRIS_PROFILE=ON)\n";
+    std::cout << "\nDeeper searches rarely top out, so combine them with --max-pieces.\n";
+}
+
+std::string formatDistribution(const tetris::Distribution &d) {
+    return fmt::format("{{\"mean\": {:.2f}, \"min\": {}, \"p50\": {}, \"p90\": {}, "
+                       "\"p99\": {}, \"max\": {}}}",
+                       d.mean, d.min, d.p50, d.p90, d.p99, d.max);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    tetris::SimulationConfig config;
+    bool json = false;
+    std::string profile_path;
+
+    // Parse command line arguments
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (arg == "--json") {
+            json = true;
+            continue;
+        }
+        if (arg == "--bag") {
+            config.randomizer = tetris::RandomizerKind::BAG;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Unknown option or missing value: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+        const char *value = argv[++i];
+        if (arg == "--games") {
+            config.games = std::atoi(value);
+        } else if (arg == "--max-pieces") {
+            config.piece_cap = std::atoi(value);
+        } else if (arg == "--seed") {
+            config.seed = std::strtoull(value, nullptr, 0);
+        } else if (arg == "--threads") {
+            config.threads = std::atoi(value);
+        } else if (arg == "--depth") {
+            config.search.depth = std::atoi(value);
+        } else if (arg == "--beam") {
+            config.search.beam_width = std::atoi(value);
+        } else if (arg == "--preview") {
+            config.preview_size = std::atoi(value);
+        } else if (arg == "--profile") {
+            profile_path = value;
+        } else if (arg == "--board") {
+            int &width = config.board_width;
+            int &height = config.board_height;
+            if (std::sscanf(value, "%dx%d", &width, &height) != 2 ||
+                !tetris::visitBoardSize(width, height, [](auto) {})) {
+                std::cerr << "Error: --board must be one of " << formatBoardSizes()
+                          << "\n";
+                return 1;
+            }
+        } else if (arg == "--weights") {
+            tetris::EvalWeights &w = config.weights;
+            if (std::sscanf(value, "%lf,%lf,%lf,%lf", &w.lines, &w.height, &w.holes,
+                            &w.bumpiness) != 4) {
+                std::cerr << "Error: --weights needs four comma-separated numbers\n";
+                return 1;
+            }
+        } else {
+            std::cerr << "Error: Unknown option: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (config.games < 1) {
+        std::cerr << "Error: Number of games must be at least 1\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<tetris::GameResult> results = tetris::runSimulation(config);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    tetris::SimulationSummary summary = tetris::summarize(results);
+    double seconds = elapsed.count();
+    double games_per_second = summary.games / seconds;
+    double pieces_per_second = static_cast<double>(summary.pieces) / seconds;
+
+    if (!profile_path.empty()) {
+        if (!tetris::PROFILING_ENABLED) {
+            std::cerr << "Warning: Built without -DTETRIS_PROFILE=ON, " << profile_path
+                      << " will hold no samples\n";
+        }
+        if (!tetris::writeProbes(profile_path)) {
+            std::cerr << "Error: Cannot write " << profile_path << "\n";
+            return 1;
+        }
+    }
+
+    if (json) {
+        fmt::print("{{\n"
+                   "  \"config\": {{\"games\": {}, \"max_pieces\": {}, \"seed\": {}, "
+                   "\"threads\": {}, \"depth\": {}, \"beam\": {}, \"preview\": {}, "
+                   "\"randomizer\": \"{}\", \"board\": \"{}x{}\"}},\n"
+                   "  \"seconds\": {:.6f},\n"
+                   "  \"games_per_second\": {:.3f},\n"
+                   "  \"pieces_per_second\": {:.1f},\n"
+                   "  \"bytes_per_game\": {},\n"
+                   "  \"pieces\": {},\n"
+                   "  \"topped_out\": {},\n"
+                   "  \"score\": {},\n"
+                   "  \"lines\": {}\n"
+                   "}}\n",
+                   config.games, config.piece_cap, config.seed, config.threads,
+                   config.search.depth, config.search.beam_width, config.preview_size,
+                   config.randomizer == tetris::RandomizerKind::BAG ? "bag" : "uniform",
+                   config.board_width, config.board_height, seconds, games_per_second,
+                   pieces_per_second, tetris::getBytesPerGame(config), summary.pieces,
+                   summary.topped_out, formatDistribution(summary.score),
+                   formatDistribution(summary.lines));
+        return 0;
+    }
+
+    fmt::print("games       {} ({} topped out) in {:.3f} s on {}x{}\n", summary.games,
+               summary.topped_out, seconds, config.board_width, config.board_height);
+    fmt::print("throughput  {:.2f} games/s, {:.0f} pieces/s\n", games_per_second,
+               pieces_per_second);
+    fmt::print("memory      {} bytes per game\n", tetris::getBytesPerGame(config));
+    fmt::print("{:<10}  {:>10} {:>8} {:>8} {:>8} {:>8} {:>8}\n", "", "mean", "min", "p50",
+               "p90", "p99", "max");
+    for (const auto &[name, d] :
+         {std::pair{"score", summary.score}, std::pair{"lines", summary.lines}}) {
+        fmt::print("{:<10}  {:>10.1f} {:>8} {:>8} {:>8} {:>8} {:>8}\n", name, d.mean, d.min,
+                   d.p50, d.p90, d.p99, d.max);
+    }
+    return 0;
+}
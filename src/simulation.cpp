@@ -0,0 +1,139 @@
+#include <tetris/game_batch.hpp>
+#include <tetris/simulation.hpp>
+#include <tetris/thread_pool.hpp>
+#include <algorithm>
+#include <utility>
+
+namespace tetris {
+
+namespace {
+
+// Lock the current piece where the AI wants it, or drop it if no move was found
+template <int Width, int Height>
+void playMove(BasicGame<Width, Height> &game, const AI::Move &move) {
+    if (!game.applyPlacement(move.rotation, {move.x, move.y})) {
+        game.drop();
+    }
+}
+
+template <int Width, int Height>
+GameResult playSizedGame(std::uint64_t seed, const SimulationConfig &config) {
+    BasicGame<Width, Height> game(seed, config.randomizer);
+    game.setPreviewSize(config.preview_size);
+    BasicAI<Width, Height> ai(config.search);
+    ai.setWeights(config.weights);
+
+    int pieces = 0;
+    while (game.getState() == GameState::PLAYING &&
+           (config.piece_cap <= 0 || pieces < config.piece_cap)) {
+        playMove(game, ai.findBestMove(game));
+        pieces++;
+    }
+    return {seed, game.getScore(), game.getLinesCleared(), pieces,
+            game.getState() == GameState::GAME_OVER};
+}
+
+bool isStandardBoard(const SimulationConfig &config) {
+    return config.board_width == BOARD_WIDTH && config.board_height == BOARD_HEIGHT;
+}
+
+Distribution distribution(std::vector<int> values) {
+    Distribution result{0.0, 0, 0, 0, 0, 0};
+    if (values.empty()) {
+        return result;
+    }
+    std::sort(values.begin(), values.end());
+    auto percentile = [&](int p) {
+        std::size_t rank = (values.size() * static_cast<std::size_t>(p) + 99) / 100;
+        return values[std::max<std::size_t>(rank, 1) - 1];
+    };
+
+    double total = 0;
+    for (int value : values) {
+        total += value;
+    }
+    result.mean = total / static_cast<double>(values.size());
+    result.min = values.front();
+    result.p50 = percentile(50);
+    result.p90 = percentile(90);
+    result.p99 = percentile(99);
+    result.max = values.back();
+    return result;
+}
+
+} // namespace
+
+std::uint64_t gameSeed(std::uint64_t seed, int game_index) {
+    return mixBits(seed + static_cast<std::uint64_t>(game_index));
+}
+
+GameResult playGame(std::uint64_t seed, const SimulationConfig &config) {
+    GameResult result{seed, 0, 0, 0, false};
+    visitBoardSize(config.board_width, config.board_height, [&](auto size) {
+        using Size = decltype(size);
+        result = playSizedGame<Size::WIDTH, Size::HEIGHT>(seed, config);
+    });
+    return result;
+}
+
+std::vector<GameResult> runSimulation(const SimulationConfig &config) {
+    if (!isStandardBoard(config)) {
+        // The games already run in parallel, so each searches serially
+        SimulationConfig game_config = config;
+        game_config.search.threads = 1;
+        std::vector<GameResult> results(static_cast<std::size_t>(config.games));
+        ThreadPool pool(config.threads);
+        pool.parallelFor(config.games, [&](int i) {
+            results[static_cast<std::size_t>(i)] =
+                playGame(gameSeed(config.seed, i), game_config);
+        });
+        return results;
+    }
+
+    GameBatch batch(config.games, config.seed, config.randomizer, config.preview_size);
+    batch.setThreads(config.threads);
+    batch.setSearchConfig(config.search);
+    batch.setWeights(config.weights);
+    batch.setPieceLimit(config.piece_cap);
+    while (batch.getActiveGames() > 0) {
+        batch.step();
+    }
+
+    std::vector<GameResult> results(static_cast<std::size_t>(batch.getNumGames()));
+    for (int i = 0; i < batch.getNumGames(); i++) {
+        results[static_cast<std::size_t>(i)] = {
+            batch.getSeed(i), batch.getScore(i), batch.getLinesCleared(i),
+            batch.getPieceCount(i), batch.getState(i) == GameState::GAME_OVER};
+    }
+    return results;
+}
+
+std::size_t getBytesPerGame(const SimulationConfig &config) {
+    if (isStandardBoard(config)) {
+        return GameBatch::getBytesPerGame();
+    }
+    std::size_t bytes = 0;
+    visitBoardSize(config.board_width, config.board_height, [&](auto size) {
+        using Size = decltype(size);
+        bytes = sizeof(BasicGame<Size::WIDTH, Size::HEIGHT>);
+    });
+    return bytes;
+}
+
+SimulationSummary summarize(const std::vector<GameResult> &results) {
+    SimulationSummary summary{};
+    std::vector<int> scores;
+    std::vector<int> lines;
+    for (const GameResult &result : results) {
+        summary.pieces += result.pieces;
+        summary.topped_out += result.topped_out ? 1 : 0;
+        scores.push_back(result.score);
+        lines.push_back(result.lines);
+    }
+    summary.games = static_cast<int>(results.size());
+    summary.score = distribution(std::move(scores));
+    summary.lines = distribution(std::move(lines));
+    return summary;
+}
+
+} // namespace tetris
@@ -1,93 +1,21 @@
 #include <tetris/tetromino.hpp>
+#include <type_traits>
 
 namespace tetris {
 
-Tetromino::Tetromino(TetrominoType type) : type_(type), rotation_(0) {
-    updateBlocks();
-}
-
-void Tetromino::rotate() {
-    rotation_ = (rotation_ + 1) % 4;
-    updateBlocks();
-}
-
-void Tetromino::rotateBack() {
-    rotation_ = (rotation_ + 3) % 4;
-    updateBlocks();
-}
-
-void Tetromino::updateBlocks() { blocks_ = getShapeBlocks(rotation_); }
-
-std::vector<Position> Tetromino::getShapeBlocks(int rotation) const {
-    std::vector<Position> blocks;
-
-    switch (type_) {
-    case TetrominoType::I:
-        if (rotation % 2 == 0) {
-            blocks = {{0, 0}, {1, 0}, {2, 0}, {3, 0}};
-        } else {
-            blocks = {{0, 0}, {0, 1}, {0, 2}, {0, 3}};
-        }
-        break;
-
-    case TetrominoType::O:
-        blocks = {{0, 0}, {1, 0}, {0, 1}, {1, 1}};
-        break;
-
-    case TetrominoType::T:
-        if (rotation == 0) {
-            blocks = {{1, 0}, {0, 1}, {1, 1}, {2, 1}};
-        } else if (rotation == 1) {
-            blocks = {{1, 0}, {1, 1}, {2, 1}, {1, 2}};
-        } else if (rotation == 2) {
-            blocks = {{0, 1}, {1, 1}, {2, 1}, {1, 2}};
-        } else {
-            blocks = {{1, 0}, {0, 1}, {1, 1}, {1, 2}};
-        }
-        break;
-
-    case TetrominoType::S:
-        if (rotation % 2 == 0) {
-            blocks = {{1, 0}, {2, 0}, {0, 1}, {1, 1}};
-        } else {
-            blocks = {{1, 0}, {1, 1}, {2, 1}, {2, 2}};
-        }
-        break;
-
-    case TetrominoType::Z:
-        if (rotation % 2 == 0) {
-            blocks = {{0, 0}, {1, 0}, {1, 1}, {2, 1}};
-        } else {
-            blocks = {{2, 0}, {1, 1}, {2, 1}, {1, 2}};
-        }
-        break;
-
-    case TetrominoType::J:
-        if (rotation == 0) {
-            blocks = {{0, 0}, {0, 1}, {1, 1}, {2, 1}};
-        } else if (rotation == 1) {
-            blocks = {{1, 0}, {2, 0}, {1, 1}, {1, 2}};
-        } else if (rotation == 2) {
-            blocks = {{0, 1}, {1, 1}, {2, 1}, {2, 2}};
-        } else {
-            blocks = {{1, 0}, {1, 1}, {0, 2}, {1, 2}};
-        }
-        break;
-
-    case TetrominoType::L:
-        if (rotation == 0) {
-            blocks = {{2, 0}, {0, 1}, {1, 1}, {2, 1}};
-        } else if (rotation == 1) {
-            blocks = {{1, 0}, {1, 1}, {1, 2}, {2, 2}};
-        } else if (rotation == 2) {
-            blocks = {{0, 1}, {1, 1}, {2, 1}, {0, 2}};
-        } else {
-            blocks = {{0, 0}, {1, 0}, {1, 1}, {1, 2}};
-        }
-        break;
-    }
-
-    return blocks;
-}
+// Tetromino is copied for every candidate the AI tries, keep it tiny
+static_assert(std::is_trivially_copyable_v<Tetromino>);
+static_assert(sizeof(Tetromino) == 2);
+
+// Spot-check the generated tables
+static_assert(SHAPE_TABLE[0][0].row_masks[0] == 0xF);  // I, flat
+static_assert(SHAPE_TABLE[0][1].max_y == 3);           // I, vertical
+static_assert(SHAPE_TABLE[2][2].min_y == 1);           // T, pointing down
+static_assert(SHAPE_TABLE[2][0].bottom[1] == 1);       // T, stem column
+static_assert(SHAPE_TABLE[3][1].left[2] == 2);         // S, vertical
+static_assert(SHAPE_TABLE[6][3].right[0] == 1);        // L, upside down
+static_assert(SHAPE_TABLE[1][3].canonical_rotation == 0); // O
+static_assert(SHAPE_TABLE[3][3].canonical_rotation == 1); // S
+static_assert(SHAPE_TABLE[2][3].canonical_rotation == 3); // T
 
 } // namespace tetris
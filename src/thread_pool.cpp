@@ -0,0 +1,147 @@
+#include <tetris/thread_pool.hpp>
+#include <algorithm>
+
+namespace tetris {
+
+namespace {
+
+// Set on pool workers so nested parallelFor calls run inline
+thread_local bool in_pool_task = false;
+// The pool a worker thread belongs to and its worker index there, so calls
+// it runs inline keep that index
+thread_local const ThreadPool *worker_pool = nullptr;
+thread_local int worker_index = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(int num_threads)
+    : function_(nullptr), context_(nullptr), busy_workers_(0), generation_(0),
+      stopping_(false) {
+    if (num_threads <= 0) {
+        num_threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    num_threads = std::max(num_threads, 1);
+    slices_ = std::make_unique<Slice[]>(static_cast<std::size_t>(num_threads));
+    for (int i = 1; i < num_threads; i++) {
+        workers_.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_ready_.notify_all();
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(int count, TaskFunction function, void *context) {
+    // Not worth a wake-up, or already inside a task
+    if (workers_.empty() || count <= 1 || in_pool_task) {
+        int worker = worker_pool == this ? worker_index : 0;
+        for (int i = 0; i < count; i++) {
+            function(context, worker, i);
+        }
+        return;
+    }
+
+    // Deal the range out in equal contiguous slices
+    int threads = getNumThreads();
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (int t = 0; t < threads; t++) {
+        Slice &slice = slices_[static_cast<std::size_t>(t)];
+        std::lock_guard<std::mutex> slice_lock(slice.mutex);
+        slice.begin = static_cast<int>(static_cast<std::int64_t>(count) * t / threads);
+        slice.end = static_cast<int>(static_cast<std::int64_t>(count) * (t + 1) / threads);
+    }
+    function_ = function;
+    context_ = context;
+    busy_workers_ = static_cast<int>(workers_.size());
+    generation_++;
+    lock.unlock();
+    work_ready_.notify_all();
+
+    in_pool_task = true;
+    work(0, function, context);
+    in_pool_task = false;
+
+    // Barrier: every index has run once all workers have checked out
+    lock.lock();
+    work_done_.wait(lock, [this] { return busy_workers_ == 0; });
+}
+
+void ThreadPool::workerLoop(int self) {
+    in_pool_task = true;
+    worker_pool = this;
+    worker_index = self;
+    std::uint64_t seen_generation = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_ready_.wait(lock, [&] { return stopping_ || generation_ != seen_generation; });
+        if (stopping_) {
+            return;
+        }
+        seen_generation = generation_;
+        TaskFunction function = function_;
+        void *context = context_;
+        lock.unlock();
+        work(self, function, context);
+        lock.lock();
+        if (--busy_workers_ == 0) {
+            work_done_.notify_one();
+        }
+    }
+}
+
+void ThreadPool::work(int self, TaskFunction function, void *context) {
+    int index = 0;
+    while (true) {
+        if (popFront(self, index)) {
+            function(context, self, index);
+        } else if (!steal(self)) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::popFront(int self, int &index) {
+    Slice &slice = slices_[static_cast<std::size_t>(self)];
+    std::lock_guard<std::mutex> lock(slice.mutex);
+    if (slice.begin >= slice.end) {
+        return false;
+    }
+    index = slice.begin++;
+    return true;
+}
+
+bool ThreadPool::steal(int self) {
+    // Visit the others in a fixed order starting after self, so thieves
+    // spread over different victims
+    int threads = getNumThreads();
+    for (int offset = 1; offset < threads; offset++) {
+        Slice &victim = slices_[static_cast<std::size_t>((self + offset) % threads)];
+        int begin = 0;
+        int end = 0;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            int remaining = victim.end - victim.begin;
+            if (remaining <= 0) {
+                continue;
+            }
+            end = victim.end;
+            begin = end - (remaining + 1) / 2;
+            victim.end = begin;
+        }
+        Slice &own = slices_[static_cast<std::size_t>(self)];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.begin = begin;
+        own.end = end;
+        return true;
+    }
+    return false;
+}
+
+} // namespace tetris
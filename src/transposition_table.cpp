@@ -0,0 +1,92 @@
+#include <tetris/board.hpp>
+#include <tetris/transposition_table.hpp>
+
+namespace tetris {
+
+TranspositionTable::TranspositionTable(int num_buckets)
+    : mask_(0), generation_(0), stats_{} {
+    if (num_buckets > 0) {
+        std::size_t size = 1;
+        while (size < static_cast<std::size_t>(num_buckets)) {
+            size <<= 1;
+        }
+        buckets_.resize(size);
+        mask_ = size - 1;
+        clear();
+    }
+}
+
+void TranspositionTable::nextGeneration() {
+    // The generation only ages entries for replacement. Once the 8-bit
+    // counter wraps, entries from 256 searches ago would look new and outlive
+    // recent ones, so start over with an empty table.
+    if (++generation_ == 0) {
+        clear();
+    }
+}
+
+void TranspositionTable::clear() {
+    for (auto &bucket : buckets_) {
+        bucket = Bucket{};
+    }
+}
+
+bool TranspositionTable::probe(std::uint64_t key, int &value) {
+    if (!enabled()) {
+        return false;
+    }
+
+    stats_.probes++;
+    for (Entry &entry : bucketFor(key).entries) {
+        if (entry.used && entry.key == key) {
+            stats_.hits++;
+            value = entry.value;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(std::uint64_t key, int value) {
+    if (!enabled()) {
+        return;
+    }
+
+    // Reuse the slot holding this key or an empty one. Otherwise evict the
+    // first entry of the oldest generation.
+    Bucket &bucket = bucketFor(key);
+    Entry *victim = &bucket.entries[0];
+    for (Entry &entry : bucket.entries) {
+        if (!entry.used || entry.key == key) {
+            victim = &entry;
+            break;
+        }
+        auto age = static_cast<std::uint8_t>(generation_ - entry.generation);
+        auto victim_age = static_cast<std::uint8_t>(generation_ - victim->generation);
+        if (age > victim_age) {
+            victim = &entry;
+        }
+    }
+
+    stats_.stores++;
+    if (victim->used && victim->key != key) {
+        stats_.replacements++;
+    }
+    *victim = {key, value, generation_, 1};
+}
+
+double TranspositionTable::getHitRate() const {
+    return stats_.probes == 0
+               ? 0.0
+               : static_cast<double>(stats_.hits) / static_cast<double>(stats_.probes);
+}
+
+std::uint64_t searchKey(int cleared_lines, int depth) {
+    if (cleared_lines == 0 && depth == 0) {
+        return 0;
+    }
+    return mixBits((static_cast<std::uint64_t>(cleared_lines) << 8) ^
+                   static_cast<std::uint64_t>(depth) ^ std::uint64_t{0x5EA4C4});
+}
+
+} // namespace tetris
@@ -0,0 +1,133 @@
+#include <tetris/tuner.hpp>
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace {
+
+void printUsage(const char *program_name) {
+    std::cout << "Usage: " << program_name << " [options]\n";
+    std::cout << "Tunes the AI evaluator weights with a genetic algorithm over seeded\n";
+    std::cout << "headless games.\n";
+    std::cout << "\nOptions:\n";
+    std::cout << "  --generations N  Run until N generations are done (default: 10)\n";
+    std::cout << "  --population N   Candidates per generation (default: 24)\n";
+    std::cout << "  --games N        Games per candidate per generation (default: 16)\n";
+    std::cout << "  --max-pieces N   Pieces per game, 0 = play to top-out (default: 500)\n";
+    std::cout << "  --seed S         Base seed (default: 1)\n";
+    std::cout << "  --threads N      Worker threads, 0 = all cores (default: 0)\n";
+    std::cout << "  --depth D        AI search depth (default: 1)\n";
+    std::cout << "  --bag            Deal pieces from shuffled 7-bags instead of uniformly\n";
+    std::cout << "  --checkpoint F   Save the run to F after every generation\n";
+    std::cout << "  --resume         Continue from the --checkpoint file if it exists\n";
+    std::cout << "\nThe best weights can be tried with tetris-sim --weights.\n";
+}
+
+std::string formatWeights(const tetris::EvalWeights &weights) {
+    return fmt::format("{:.6f},{:.6f},{:.6f},{:.6f}", weights.lines, weights.height,
+                       weights.holes, weights.bumpiness);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    tetris::TunerConfig config;
+    int generations = 10;
+    std::string checkpoint;
+    bool resume = false;
+
+    // Parse command line arguments
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (arg == "--resume") {
+            resume = true;
+            continue;
+        }
+        if (arg == "--bag") {
+            config.randomizer = tetris::RandomizerKind::BAG;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Unknown option or missing value: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+        const char *value = argv[++i];
+        if (arg == "--generations") {
+            generations = std::atoi(value);
+        } else if (arg == "--population") {
+            config.population = std::atoi(value);
+        } else if (arg == "--games") {
+            config.games = std::atoi(value);
+        } else if (arg == "--max-pieces") {
+            config.piece_cap = std::atoi(value);
+        } else if (arg == "--seed") {
+            config.seed = std::strtoull(value, nullptr, 0);
+        } else if (arg == "--threads") {
+            config.threads = std::atoi(value);
+        } else if (arg == "--depth") {
+            config.search.depth = std::atoi(value);
+        } else if (arg == "--checkpoint") {
+            checkpoint = value;
+        } else {
+            std::cerr << "Error: Unknown option: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (config.population < 2) {
+        std::cerr << "Error: Population must be at least 2\n";
+        return 1;
+    }
+    if (resume && checkpoint.empty()) {
+        std::cerr << "Error: --resume needs --checkpoint\n";
+        return 1;
+    }
+
+    tetris::Tuner tuner(config);
+    if (resume && std::ifstream(checkpoint)) {
+        if (!tuner.loadCheckpoint(checkpoint)) {
+            std::cerr << "Error: Cannot resume from " << checkpoint
+                      << " (unreadable, or from a run with another seed, population"
+                      << " or games count)\n";
+            return 1;
+        }
+        fmt::print("resumed at generation {}\n", tuner.getGeneration());
+    }
+
+    while (tuner.getGeneration() < generations) {
+        auto start = std::chrono::steady_clock::now();
+        tuner.runGeneration();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        const auto &scored = tuner.getScored();
+        double mean = 0.0;
+        for (const auto &candidate : scored) {
+            mean += candidate.fitness;
+        }
+        mean /= static_cast<double>(scored.size());
+        fmt::print("generation {:>3}  best {:>10.1f}  mean {:>10.1f}  {:.2f} s  weights {}\n",
+                   tuner.getGeneration(), scored.front().fitness, mean, elapsed.count(),
+                   formatWeights(scored.front().weights));
+
+        if (!checkpoint.empty() && !tuner.saveCheckpoint(checkpoint)) {
+            std::cerr << "Error: Cannot write checkpoint " << checkpoint << "\n";
+            return 1;
+        }
+    }
+
+    if (!tuner.getScored().empty()) {
+        fmt::print("best weights (lines,height,holes,bumpiness): {}\n",
+                   formatWeights(tuner.getScored().front().weights));
+    }
+    return 0;
+}
@@ -0,0 +1,263 @@
+#include <tetris/simulation.hpp>
+#include <tetris/tuner.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace tetris {
+
+namespace {
+
+constexpr const char *CHECKPOINT_MAGIC = "tetris-tune-checkpoint";
+constexpr int CHECKPOINT_VERSION = 3;
+
+// Uniform in [0, 1)
+double uniform(Xoshiro256 &rng) { return static_cast<double>(rng.next() >> 11) * 0x1.0p-53; }
+
+// Separate streams for the first population, each generation's games and
+// each generation's breeding
+std::uint64_t streamSeed(std::uint64_t seed, int generation, std::uint64_t stream) {
+    return mixBits(mixBits(seed + stream) + static_cast<std::uint64_t>(generation));
+}
+
+constexpr std::uint64_t INITIAL_STREAM = 0;
+constexpr std::uint64_t GAMES_STREAM = 1;
+constexpr std::uint64_t BREED_STREAM = 2;
+
+void writeWeights(std::ostream &out, const EvalWeights &weights) {
+    out << weights.lines << ' ' << weights.height << ' ' << weights.holes << ' '
+        << weights.bumpiness;
+}
+
+bool readWeights(std::istream &in, EvalWeights &weights) {
+    return static_cast<bool>(in >> weights.lines >> weights.height >> weights.holes >>
+                             weights.bumpiness);
+}
+
+// The settings a run's results depend on, one "<name> <value>" line each.
+// Thread counts and the table size only change how fast it goes.
+void writeSettings(std::ostream &out, const TunerConfig &config) {
+    out << "seed " << config.seed << '\n';
+    out << "population_size " << config.population << '\n';
+    out << "games " << config.games << '\n';
+    out << "piece_cap " << config.piece_cap << '\n';
+    out << "elite " << config.elite << '\n';
+    out << "tournament " << config.tournament << '\n';
+    out << "mutation_rate " << config.mutation_rate << '\n';
+    out << "mutation_step " << config.mutation_step << '\n';
+    out << "preview_size " << config.preview_size << '\n';
+    out << "randomizer " << static_cast<int>(config.randomizer) << '\n';
+    out << "search_depth " << config.search.depth << '\n';
+    out << "beam_width " << config.search.beam_width << '\n';
+}
+
+// Reads "<name> <value>"
+template <typename T> bool readField(std::istream &in, const char *name, T &value) {
+    std::string field;
+    return (in >> field >> value) && field == name;
+}
+
+} // namespace
+
+EvalWeights normalizeWeights(const EvalWeights &weights) {
+    double length = std::sqrt(weights.lines * weights.lines + weights.height * weights.height +
+                              weights.holes * weights.holes +
+                              weights.bumpiness * weights.bumpiness);
+    if (length == 0.0) {
+        return weights;
+    }
+    return {weights.lines / length, weights.height / length, weights.holes / length,
+            weights.bumpiness / length};
+}
+
+Tuner::Tuner(const TunerConfig &config)
+    : config_(config), pool_(config.threads), generation_(0) {
+    config_.population = std::max(config_.population, 1);
+    config_.games = std::max(config_.games, 1);
+    config_.elite = std::clamp(config_.elite, 0, config_.population);
+    config_.tournament = std::max(config_.tournament, 1);
+    // Games already run in parallel, each search stays on its own thread
+    config_.search.threads = 1;
+
+    Xoshiro256 rng(streamSeed(config_.seed, 0, INITIAL_STREAM));
+    population_.push_back(normalizeWeights(EvalWeights{}));
+    while (static_cast<int>(population_.size()) < config_.population) {
+        EvalWeights weights{uniform(rng) * 2 - 1, uniform(rng) * 2 - 1, uniform(rng) * 2 - 1,
+                            uniform(rng) * 2 - 1};
+        population_.push_back(normalizeWeights(weights));
+    }
+}
+
+void Tuner::runGeneration() {
+    SimulationConfig sim;
+    sim.piece_cap = config_.piece_cap;
+    sim.preview_size = config_.preview_size;
+    sim.randomizer = config_.randomizer;
+    sim.search = config_.search;
+
+    // One task per (candidate, game). Every candidate plays the same games,
+    // so differences in fitness come from the weights and not the pieces.
+    std::uint64_t games_seed = streamSeed(config_.seed, generation_, GAMES_STREAM);
+    int games = config_.games;
+    game_scores_.assign(population_.size() * static_cast<std::size_t>(games), 0);
+    pool_.parallelFor(static_cast<int>(game_scores_.size()), [&](int task) {
+        SimulationConfig game_config = sim;
+        game_config.weights = population_[static_cast<std::size_t>(task / games)];
+        game_scores_[static_cast<std::size_t>(task)] =
+            playGame(gameSeed(games_seed, task % games), game_config).score;
+    });
+
+    scored_.clear();
+    for (std::size_t i = 0; i < population_.size(); i++) {
+        double total = 0.0;
+        for (int game = 0; game < games; game++) {
+            total += game_scores_[i * static_cast<std::size_t>(games) +
+                                  static_cast<std::size_t>(game)];
+        }
+        scored_.push_back({population_[i], total / games});
+    }
+    std::stable_sort(scored_.begin(), scored_.end(),
+                     [](const TunedWeights &a, const TunedWeights &b) {
+                         return a.fitness > b.fitness;
+                     });
+
+    Xoshiro256 rng(streamSeed(config_.seed, generation_, BREED_STREAM));
+    breed(rng);
+    generation_++;
+}
+
+const TunedWeights &Tuner::select(Xoshiro256 &rng) const {
+    // scored_ is sorted, so the lowest index drawn is the fittest
+    auto size = static_cast<std::uint32_t>(scored_.size());
+    std::uint32_t best = rng.below(size);
+    for (int i = 1; i < config_.tournament; i++) {
+        best = std::min(best, rng.below(size));
+    }
+    return scored_[best];
+}
+
+void Tuner::breed(Xoshiro256 &rng) {
+    population_.clear();
+    for (int i = 0; i < config_.elite; i++) {
+        population_.push_back(scored_[static_cast<std::size_t>(i)].weights);
+    }
+
+    while (static_cast<int>(population_.size()) < config_.population) {
+        // Blend two parents, each weighted by its fitness
+        const TunedWeights &a = select(rng);
+        const TunedWeights &b = select(rng);
+        double wa = std::max(a.fitness, 0.0) + 1.0;
+        double wb = std::max(b.fitness, 0.0) + 1.0;
+        EvalWeights child{a.weights.lines * wa + b.weights.lines * wb,
+                          a.weights.height * wa + b.weights.height * wb,
+                          a.weights.holes * wa + b.weights.holes * wb,
+                          a.weights.bumpiness * wa + b.weights.bumpiness * wb};
+        child = normalizeWeights(child);
+
+        if (uniform(rng) < config_.mutation_rate) {
+            double nudge = (uniform(rng) * 2 - 1) * config_.mutation_step;
+            switch (rng.below(4)) {
+            case 0:
+                child.lines += nudge;
+                break;
+            case 1:
+                child.height += nudge;
+                break;
+            case 2:
+                child.holes += nudge;
+                break;
+            default:
+                child.bumpiness += nudge;
+                break;
+            }
+            child = normalizeWeights(child);
+        }
+        population_.push_back(child);
+    }
+}
+
+bool Tuner::saveCheckpoint(const std::string &path) const {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out << std::setprecision(std::numeric_limits<double>::max_digits10);
+        out << CHECKPOINT_MAGIC << ' ' << CHECKPOINT_VERSION << '\n';
+        writeSettings(out, config_);
+        out << "generation " << generation_ << '\n';
+        out << "scored " << scored_.size() << '\n';
+        for (const TunedWeights &candidate : scored_) {
+            out << candidate.fitness << ' ';
+            writeWeights(out, candidate.weights);
+            out << '\n';
+        }
+        out << "population " << population_.size() << '\n';
+        for (const EvalWeights &weights : population_) {
+            writeWeights(out, weights);
+            out << '\n';
+        }
+        if (!out.flush()) {
+            return false;
+        }
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+bool Tuner::loadCheckpoint(const std::string &path) {
+    std::ifstream in(path);
+    std::string magic;
+    int version = 0;
+    if (!(in >> magic >> version) || magic != CHECKPOINT_MAGIC ||
+        version != CHECKPOINT_VERSION) {
+        return false;
+    }
+
+    // The run only carries on exactly with the settings that shaped it, so
+    // they have to match ours line for line
+    std::ostringstream settings;
+    settings << std::setprecision(std::numeric_limits<double>::max_digits10);
+    writeSettings(settings, config_);
+    std::istringstream expected(settings.str());
+    std::string want;
+    std::string got;
+    in >> std::ws;
+    while (std::getline(expected, want)) {
+        if (!std::getline(in, got) || got != want) {
+            return false;
+        }
+    }
+
+    int generation = 0;
+    std::size_t count = 0;
+    if (!readField(in, "generation", generation) || !readField(in, "scored", count)) {
+        return false;
+    }
+    std::vector<TunedWeights> scored(count);
+    for (TunedWeights &candidate : scored) {
+        if (!(in >> candidate.fitness) || !readWeights(in, candidate.weights)) {
+            return false;
+        }
+    }
+    if (!readField(in, "population", count) || count == 0) {
+        return false;
+    }
+    std::vector<EvalWeights> population(count);
+    for (EvalWeights &weights : population) {
+        if (!readWeights(in, weights)) {
+            return false;
+        }
+    }
+
+    generation_ = generation;
+    scored_ = std::move(scored);
+    population_ = std::move(population);
+    return true;
+}
+
+} // namespace tetris
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+namespace tetris::testing {
+
+// Number of times the global operator new has run in this program, on any
+// thread. Linking allocation_counter replaces every form of operator new
+// with one that counts, then allocates as usual.
+std::uint64_t allocationCount();
+
+// Counts the allocations made while it is alive
+class AllocationScope {
+  public:
+    AllocationScope() : start_(allocationCount()) {}
+    std::uint64_t count() const { return allocationCount() - start_; }
+
+  private:
+    std::uint64_t start_;
+};
+
+} // namespace tetris::testing
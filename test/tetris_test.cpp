@@ -1,9 +1,30 @@
+#include "allocation_counter.hpp"
 #include <gtest/gtest.h>
 #include <tetris/ai.hpp>
+#include <tetris/batch_eval.hpp>
 #include <tetris/board.hpp>
 #include <tetris/game.hpp>
+#include <tetris/game_batch.hpp>
+#include <tetris/game_loop.hpp>
+#include <tetris/league.hpp>
+#include <tetris/move_generator.hpp>
 #include <tetris/multiplayer.hpp>
+#include <tetris/profiler.hpp>
+#include <tetris/randomizer.hpp>
+#include <tetris/recording.hpp>
+#include <tetris/simulation.hpp>
 #include <tetris/tetromino.hpp>
+#include <tetris/thread_pool.hpp>
+#include <tetris/tuner.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <thread>
+#include <type_traits>
 
 // Test Tetromino creation and rotation
 TEST(TetrominoTest, CreateAndRotate) {
@@ -18,6 +39,32 @@ TEST(TetrominoTest, CreateAndRotate) {
     EXPECT_EQ(piece.getRotation(), 2);
 }
 
+// Test that pieces share their block offsets from the static shape tables
+TEST(TetrominoTest, BlocksComeFromStaticTables) {
+    tetris::Tetromino a(tetris::TetrominoType::T);
+    tetris::Tetromino b(tetris::TetrominoType::T);
+    EXPECT_EQ(&a.getBlocks(), &b.getBlocks());
+
+    // Four rotations bring a piece back to its starting orientation
+    const auto *initial = &a.getBlocks();
+    a.rotate();
+    EXPECT_NE(&a.getBlocks(), initial);
+    a.rotateBack();
+    EXPECT_EQ(&a.getBlocks(), initial);
+    for (int i = 0; i < 4; i++) {
+        a.rotate();
+    }
+    EXPECT_EQ(&a.getBlocks(), initial);
+
+    // Masks and bounds agree with the block offsets
+    const tetris::ShapeInfo &shape = a.getShape();
+    EXPECT_EQ(shape.row_masks[0], 0x2);
+    EXPECT_EQ(shape.row_masks[1], 0x7);
+    EXPECT_EQ(shape.min_x, 0);
+    EXPECT_EQ(shape.max_x, 2);
+    EXPECT_EQ(shape.max_y, 1);
+}
+
 // Test Board initialization
 TEST(BoardTest, Initialization) {
     tetris::Board board;
@@ -60,6 +107,289 @@ TEST(BoardTest, ClearLines) {
     EXPECT_GT(cleared, 0);
 }
 
+// Test that the occupancy bitboard and color plane stay in sync
+TEST(BoardTest, RowMasksMatchCells) {
+    tetris::Board board;
+    tetris::Tetromino piece(tetris::TetrominoType::T);
+    board.place(piece, {3, 18});
+
+    for (int y = 0; y < board.getHeight(); y++) {
+        for (int x = 0; x < board.getWidth(); x++) {
+            bool occupied = (board.getRow(y) >> x) & 1u;
+            EXPECT_EQ(occupied, board.getCell(x, y) != 0);
+        }
+    }
+    EXPECT_EQ(board.getCell(4, 18), static_cast<int>(tetris::TetrominoType::T) + 1);
+
+    // Pieces whose first local row is empty may hang above the top edge
+    piece.rotate();
+    piece.rotate();
+    EXPECT_TRUE(board.canPlace(piece, {0, -1}));
+    EXPECT_FALSE(board.canPlace(piece, {3, 17}));
+}
+
+// Test that clearing rows moves the blocks and colors above them down
+TEST(BoardTest, ClearLinesShiftsRowsAbove) {
+    tetris::Board board;
+    tetris::Tetromino i_piece(tetris::TetrominoType::I);
+    tetris::Tetromino o_piece(tetris::TetrominoType::O);
+
+    // Two full rows with an O piece resting on top
+    board.place(o_piece, {0, 18});
+    board.place(i_piece, {2, 18});
+    board.place(i_piece, {2, 19});
+    board.place(i_piece, {6, 18});
+    board.place(i_piece, {6, 19});
+    board.place(o_piece, {4, 16});
+    EXPECT_EQ(board.getRow(19), tetris::FULL_ROW_MASK);
+
+    EXPECT_EQ(board.clearLines(), 2);
+    EXPECT_EQ(board.getRow(19), 0x30);
+    EXPECT_EQ(board.getRow(18), 0x30);
+    EXPECT_EQ(board.getCell(4, 19), static_cast<int>(tetris::TetrominoType::O) + 1);
+    EXPECT_EQ(board.getCell(0, 19), 0);
+    EXPECT_FALSE(board.isGameOver());
+}
+
+// Test that incrementally maintained statistics match a full rescan
+TEST(BoardTest, IncrementalStatisticsMatchRescan) {
+    tetris::Board board;
+    std::mt19937 rng(12345);
+
+    for (int step = 0; step < 500 && !board.isGameOver(); step++) {
+        tetris::Tetromino piece(static_cast<tetris::TetrominoType>(rng() % 7));
+        for (unsigned r = rng() % 4; r > 0; r--) {
+            piece.rotate();
+        }
+        tetris::Position pos{static_cast<int>(rng() % 10) - 1, 0};
+        if (!board.canPlace(piece, pos)) {
+            continue;
+        }
+        while (board.canPlace(piece, {pos.x, pos.y + 1})) {
+            pos.y++;
+        }
+        board.place(piece, pos);
+        board.clearLines();
+
+        int aggregate = 0;
+        int holes = 0;
+        tetris::Board::Cells cells{};
+        for (int x = 0; x < board.getWidth(); x++) {
+            int top = board.getHeight();
+            for (int y = board.getHeight() - 1; y >= 0; y--) {
+                if (board.getCell(x, y) != 0) {
+                    top = y;
+                }
+            }
+            for (int y = top; y < board.getHeight(); y++) {
+                holes += board.getCell(x, y) == 0 ? 1 : 0;
+                cells[static_cast<std::size_t>(y)][static_cast<std::size_t>(x)] =
+                    static_cast<std::uint8_t>(board.getCell(x, y));
+            }
+            EXPECT_EQ(board.getColumnHeight(x), board.getHeight() - top);
+            aggregate += board.getHeight() - top;
+        }
+        EXPECT_EQ(board.getAggregateHeight(), aggregate);
+        EXPECT_EQ(board.getHoles(), holes);
+        EXPECT_EQ(board.getFullRows(), 0);
+
+        tetris::Board rescan;
+        rescan.loadCells(cells);
+        EXPECT_EQ(board.getHash(), rescan.getHash());
+    }
+}
+
+// Test that undo() restores cells and statistics after placements with clears
+TEST(BoardTest, ApplyPlacementUndo) {
+    tetris::Board board;
+    tetris::Tetromino i_piece(tetris::TetrominoType::I);
+    tetris::Tetromino o_piece(tetris::TetrominoType::O);
+
+    // Two nearly full rows, a gap at columns 8-9 and a block above them
+    board.place(i_piece, {0, 18});
+    board.place(i_piece, {0, 19});
+    board.place(i_piece, {4, 18});
+    board.place(i_piece, {4, 19});
+    board.place(o_piece, {2, 16});
+
+    const tetris::Board before = board;
+    tetris::PlacementUndo undo = board.applyPlacement(o_piece, {8, 18});
+    EXPECT_EQ(undo.lines_cleared, 2);
+    EXPECT_EQ(board.getAggregateHeight(), 4);
+    EXPECT_EQ(board.getCell(2, 19), static_cast<int>(tetris::TetrominoType::O) + 1);
+
+    board.undo(undo);
+    for (int y = 0; y < board.getHeight(); y++) {
+        EXPECT_EQ(board.getRow(y), before.getRow(y));
+        for (int x = 0; x < board.getWidth(); x++) {
+            EXPECT_EQ(board.getCell(x, y), before.getCell(x, y));
+        }
+    }
+    EXPECT_EQ(board.getAggregateHeight(), before.getAggregateHeight());
+    EXPECT_EQ(board.getHoles(), before.getHoles());
+    EXPECT_EQ(board.getColumnHeights(), before.getColumnHeights());
+
+    // A placement without clears round-trips as well
+    undo = board.applyPlacement(i_piece, {4, 17});
+    EXPECT_EQ(undo.lines_cleared, 0);
+    board.undo(undo);
+    EXPECT_EQ(board.getRow(17), before.getRow(17));
+    EXPECT_EQ(board.getAggregateHeight(), before.getAggregateHeight());
+
+    // A full row left by loadCells() is outside any undo record, so it is
+    // refused rather than cleared beyond recovery
+    tetris::Board::Cells cells{};
+    cells[19].fill(1);
+    board.loadCells(cells);
+    EXPECT_DEBUG_DEATH(board.applyPlacement(o_piece, {0, 0}), "without full rows");
+}
+
+// Test that line clears, which relink color rows instead of copying them,
+// read back through getCell() exactly like rows copied down
+TEST(BoardTest, RelinkedRowsMatchCopiedRows) {
+    tetris::Game game(7);
+    tetris::AI ai;
+    tetris::Board::Cells expected{};
+    int cleared = 0;
+    for (int i = 0; i < 300 && game.getState() == tetris::GameState::PLAYING; i++) {
+        tetris::AI::Move move = ai.findBestMove(game);
+        tetris::Tetromino piece(game.getCurrentPiece().getType(), move.rotation);
+        ASSERT_TRUE(game.applyPlacement(move.rotation, {move.x, move.y}));
+
+        // Reference: draw the piece, then copy the rows above each full row down
+        for (const auto &block : piece.getBlocks()) {
+            expected[static_cast<std::size_t>(move.y + block.y)]
+                    [static_cast<std::size_t>(move.x + block.x)] =
+                static_cast<std::uint8_t>(static_cast<int>(piece.getType()) + 1);
+        }
+        for (auto row = expected.begin(); row != expected.end(); ++row) {
+            if (std::find(row->begin(), row->end(), 0) == row->end()) {
+                std::copy_backward(expected.begin(), row, row + 1);
+                expected[0].fill(0);
+                cleared++;
+            }
+        }
+
+        const tetris::Board &board = game.getBoard();
+        for (int y = 0; y < board.getHeight(); y++) {
+            const auto &row = expected[static_cast<std::size_t>(y)];
+            for (int x = 0; x < board.getWidth(); x++) {
+                ASSERT_EQ(board.getCell(x, y), row[static_cast<std::size_t>(x)]);
+            }
+        }
+    }
+    EXPECT_GT(cleared, 20);
+
+    // A cleared row's slot is relinked to the top of the stack. Drawing over
+    // it there and undoing both placements must still bring the cleared
+    // colors back.
+    tetris::Board board;
+    tetris::Tetromino i_piece(tetris::TetrominoType::I);
+    tetris::Tetromino o_piece(tetris::TetrominoType::O);
+    board.place(i_piece, {0, 19});
+    board.place(i_piece, {4, 19});
+    const tetris::Board before = board;
+    tetris::PlacementUndo clear = board.applyPlacement(o_piece, {8, 18});
+    EXPECT_EQ(clear.lines_cleared, 1);
+    tetris::PlacementUndo top = board.applyPlacement(o_piece, {0, 17});
+    EXPECT_EQ(board.getCell(0, 18), static_cast<int>(tetris::TetrominoType::O) + 1);
+    board.undo(top);
+    board.undo(clear);
+    for (int y = 0; y < board.getHeight(); y++) {
+        EXPECT_EQ(board.getRow(y), before.getRow(y));
+        for (int x = 0; x < board.getWidth(); x++) {
+            EXPECT_EQ(board.getCell(x, y), before.getCell(x, y));
+        }
+    }
+}
+
+// Test that the Zobrist hash depends only on which cells are occupied
+TEST(BoardTest, ZobristHashTracksOccupancy) {
+    tetris::Tetromino i_piece(tetris::TetrominoType::I);
+    tetris::Tetromino o_piece(tetris::TetrominoType::O);
+    tetris::Board a;
+    tetris::Board b;
+    EXPECT_EQ(a.getHash(), b.getHash());
+
+    // Same cells placed in a different order
+    a.place(i_piece, {0, 19});
+    a.place(o_piece, {5, 18});
+    b.place(o_piece, {5, 18});
+    b.place(i_piece, {0, 19});
+    EXPECT_EQ(a.getHash(), b.getHash());
+
+    // The predicted hash matches the real one, and undo restores it
+    std::uint64_t before = a.getHash();
+    std::uint64_t predicted = a.getHashAfterPlace(i_piece, {0, 18});
+    tetris::PlacementUndo undo = a.applyPlacement(i_piece, {0, 18});
+    EXPECT_EQ(a.getHash(), predicted);
+    a.undo(undo);
+    EXPECT_EQ(a.getHash(), before);
+
+    // Clearing rows rehashes the cells that moved down
+    tetris::Tetromino t_piece(tetris::TetrominoType::T);
+    tetris::Board cleared;
+    for (int x = 0; x < 10; x += 2) {
+        cleared.place(o_piece, {x, 18});
+    }
+    cleared.place(t_piece, {0, 16});
+    EXPECT_EQ(cleared.clearLines(), 2);
+    tetris::Board direct;
+    direct.place(t_piece, {0, 18});
+    EXPECT_EQ(cleared.getHash(), direct.getHash());
+}
+
+// Test that every compiled board size clears, undoes and generates moves
+TEST(BoardTest, EveryBoardSize) {
+    static_assert(std::is_same_v<tetris::RowMask, std::uint16_t>);
+    static_assert(std::is_same_v<tetris::RowMaskFor<32>, std::uint32_t>);
+    static_assert(std::is_same_v<tetris::RowMaskFor<48>, std::uint64_t>);
+
+    for (const auto &[width, height] : tetris::BOARD_SIZES) {
+        bool compiled = tetris::visitBoardSize(width, height, [&](auto size) {
+            using Size = decltype(size);
+            using Board = tetris::BasicBoard<Size::WIDTH, Size::HEIGHT>;
+            Board board;
+            EXPECT_EQ(board.getWidth(), width);
+            EXPECT_EQ(board.getHeight(), height);
+            EXPECT_EQ(std::bitset<64>(Board::FULL_ROW_MASK).count(),
+                      static_cast<std::size_t>(width));
+
+            // T has 4 * width - 6 distinct drops on an empty board
+            tetris::BasicMoveGenerator<Size::WIDTH, Size::HEIGHT> generator;
+            tetris::Tetromino t_piece(tetris::TetrominoType::T);
+            tetris::Position spawn = tetris::spawnPosition(width);
+            EXPECT_EQ(generator.generate(board, t_piece, spawn).size(),
+                      static_cast<std::size_t>(4 * width - 6));
+
+            // Fill the bottom row but its last column, only a vertical I clears it
+            tetris::Tetromino flat(tetris::TetrominoType::I);
+            for (int x = 0; x < width - 1; x += 4) {
+                board.place(flat, {std::min(x, width - 5), height - 1});
+            }
+            EXPECT_EQ(board.getRowFill(height - 1), width - 1);
+            std::uint64_t hash = board.getHash();
+            int clears = 0;
+            for (const auto &placement :
+                 generator.generate(board, flat, spawn)) {
+                tetris::Tetromino piece(flat.getType(), placement.rotation);
+                auto undo = board.applyPlacement(piece, placement.pos);
+                if (undo.lines_cleared == 1) {
+                    clears++;
+                    EXPECT_EQ(board.getRowFill(height - 1), 1);
+                    EXPECT_EQ(board.getCell(0, height - 1), 0);
+                }
+                board.undo(undo);
+                EXPECT_EQ(board.getHash(), hash);
+            }
+            EXPECT_EQ(clears, 1);
+            EXPECT_NE(board.getCell(0, height - 1), 0);
+        });
+        EXPECT_TRUE(compiled);
+    }
+    EXPECT_FALSE(tetris::visitBoardSize(12, 24, [](auto) { FAIL(); }));
+}
+
 // Test game initialization
 TEST(GameTest, Initialization) {
     tetris::Game game;
@@ -82,6 +412,237 @@ TEST(GameTest, Reset) {
     EXPECT_EQ(game.getState(), tetris::GameState::PLAYING);
 }
 
+// Test that the preview queue feeds the next spawned piece
+TEST(GameTest, PreviewQueue) {
+    tetris::Game game;
+    EXPECT_EQ(game.getPreviewSize(), tetris::DEFAULT_PREVIEW_SIZE);
+
+    tetris::TetrominoType next = game.getPreview(0);
+    tetris::TetrominoType after_next = game.getPreview(1);
+    game.drop();
+    ASSERT_EQ(game.getState(), tetris::GameState::PLAYING);
+    EXPECT_EQ(game.getCurrentPiece().getType(), next);
+    EXPECT_EQ(game.getPreview(0), after_next);
+
+    // Shrinking and growing the preview keeps the upcoming order
+    tetris::TetrominoType upcoming[3] = {game.getPreview(0), game.getPreview(1),
+                                         game.getPreview(2)};
+    game.setPreviewSize(1);
+    game.setPreviewSize(3);
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(game.getPreview(i), upcoming[i]);
+    }
+
+    game.setPreviewSize(100);
+    EXPECT_EQ(game.getPreviewSize(), tetris::MAX_PREVIEW_SIZE);
+}
+
+// Test that seeds reproduce piece streams and bags deal each piece once
+TEST(GameTest, SeededRandomizer) {
+    for (auto kind : {tetris::RandomizerKind::UNIFORM, tetris::RandomizerKind::BAG}) {
+        tetris::Randomizer a(99, kind);
+        tetris::Randomizer b(99, kind);
+        tetris::Randomizer other(100, kind);
+        int differences = 0;
+        for (int i = 0; i < 3 * tetris::Randomizer::BLOCK_SIZE; i++) {
+            tetris::TetrominoType type = a.next();
+            EXPECT_EQ(type, b.next());
+            differences += type != other.next();
+        }
+        EXPECT_GT(differences, 0);
+    }
+
+    // Every aligned run of seven pieces from a bag is a permutation
+    tetris::Randomizer bag(5, tetris::RandomizerKind::BAG);
+    for (int run = 0; run < 20; run++) {
+        int seen = 0;
+        for (int i = 0; i < tetris::NUM_TETROMINO_TYPES; i++) {
+            seen |= 1 << static_cast<int>(bag.next());
+        }
+        EXPECT_EQ(seen, (1 << tetris::NUM_TETROMINO_TYPES) - 1);
+    }
+
+    // Uniform draws cover every piece with roughly equal counts
+    tetris::Randomizer uniform(5);
+    int counts[tetris::NUM_TETROMINO_TYPES] = {};
+    for (int i = 0; i < 7000; i++) {
+        counts[static_cast<int>(uniform.next())]++;
+    }
+    for (int count : counts) {
+        EXPECT_GT(count, 850);
+        EXPECT_LT(count, 1150);
+    }
+
+    // Games with equal seeds spawn equal pieces
+    tetris::Game first(42, tetris::RandomizerKind::BAG);
+    tetris::Game second(42, tetris::RandomizerKind::BAG);
+    EXPECT_EQ(first.getRandomizerKind(), tetris::RandomizerKind::BAG);
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(first.getCurrentPiece().getType(), second.getCurrentPiece().getType());
+        EXPECT_EQ(first.getPreview(0), second.getPreview(0));
+        first.drop();
+        second.drop();
+    }
+}
+
+// Test that placing a piece directly matches steering it there
+TEST(GameTest, ApplyPlacement) {
+    tetris::Game game(5);
+    tetris::AI ai;
+    for (int move = 0; move < 40 && game.getState() == tetris::GameState::PLAYING; move++) {
+        tetris::AI::Move best = ai.findBestMove(game);
+        tetris::Game steered = game;
+        steered.applyPath(best.path);
+        ASSERT_TRUE(game.applyPlacement(best.rotation, {best.x, best.y}));
+        EXPECT_EQ(game.getBoard().getHash(), steered.getBoard().getHash());
+        EXPECT_EQ(game.getScore(), steered.getScore());
+        EXPECT_EQ(game.getCurrentPiece().getType(), steered.getCurrentPiece().getType());
+        EXPECT_EQ(game.getState(), steered.getState());
+    }
+
+    // Spots the piece cannot rest on are refused without side effects
+    game.reset();
+    std::uint64_t hash = game.getBoard().getHash();
+    tetris::Position pos = game.getCurrentPosition();
+    EXPECT_FALSE(game.applyPlacement(0, {pos.x, 5}));
+    EXPECT_FALSE(game.applyPlacement(0, {-3, tetris::BOARD_HEIGHT - 2}));
+    EXPECT_FALSE(game.applyPlacement(4, {pos.x, tetris::BOARD_HEIGHT - 2}));
+    EXPECT_EQ(game.getBoard().getHash(), hash);
+    EXPECT_EQ(game.getCurrentPosition().y, pos.y);
+}
+
+// Test that on an open board the reachable spots are exactly the hard drops
+TEST(MoveGeneratorTest, EmptyBoardMatchesHardDrops) {
+    tetris::Board board;
+    tetris::MoveGenerator generator;
+    for (int t = 0; t < tetris::NUM_TETROMINO_TYPES; t++) {
+        auto type = static_cast<tetris::TetrominoType>(t);
+        std::vector<std::uint64_t> expected;
+        for (int rotation = 0; rotation < 4; rotation++) {
+            tetris::Tetromino piece(type, rotation);
+            for (int x = -3; x < board.getWidth(); x++) {
+                tetris::Position pos{x, 0};
+                if (!board.canPlace(piece, pos)) {
+                    continue;
+                }
+                while (board.canPlace(piece, {x, pos.y + 1})) {
+                    pos.y++;
+                }
+                expected.push_back(board.getHashAfterPlace(piece, pos));
+            }
+        }
+        std::sort(expected.begin(), expected.end());
+        expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+
+        std::vector<std::uint64_t> generated;
+        for (const auto &placement :
+             generator.generate(board, tetris::Tetromino(type), tetris::SPAWN_POSITION)) {
+            generated.push_back(board.getHashAfterPlace(
+                tetris::Tetromino(type, placement.rotation), placement.pos));
+        }
+        std::sort(generated.begin(), generated.end());
+        EXPECT_EQ(generated, expected);
+    }
+
+    // T has 8 + 9 + 8 + 9 distinct drops
+    EXPECT_EQ(generator.generate(board, tetris::Tetromino(tetris::TetrominoType::T),
+                                 tetris::SPAWN_POSITION)
+                  .size(),
+              34u);
+}
+
+// Test that pieces can slide under an overhang a hard drop cannot reach
+TEST(MoveGeneratorTest, FindsTucks) {
+    tetris::Board board;
+    board.place(tetris::Tetromino(tetris::TetrominoType::I), {0, 17});
+    tetris::Tetromino piece(tetris::TetrominoType::O);
+    tetris::MoveGenerator generator;
+
+    bool tucked = false;
+    for (const auto &placement : generator.generate(board, piece, tetris::SPAWN_POSITION)) {
+        tucked = tucked || (placement.pos.x == 0 && placement.pos.y == 18);
+    }
+    EXPECT_TRUE(tucked);
+
+    tetris::InputPath path;
+    ASSERT_TRUE(generator.findPath({0, {0, 18}}, path));
+    EXPECT_EQ(path.inputs[static_cast<std::size_t>(path.length - 1)], tetris::Input::DROP);
+}
+
+// Test that every placement's input path locks the piece where promised
+TEST(MoveGeneratorTest, PathsReachPlacements) {
+    tetris::Game game(11);
+    tetris::AI ai;
+    tetris::MoveGenerator generator;
+    for (int move = 0; move < 30 && game.getState() == tetris::GameState::PLAYING; move++) {
+        const tetris::Tetromino &piece = game.getCurrentPiece();
+        std::vector<tetris::MoveGenerator::Placement> placements = generator.generate(
+            game.getBoard(), piece, game.getCurrentPosition());
+        ASSERT_FALSE(placements.empty());
+        for (const auto &placement : placements) {
+            tetris::Board expected = game.getBoard();
+            expected.applyPlacement(tetris::Tetromino(piece.getType(), placement.rotation),
+                                    placement.pos);
+
+            tetris::InputPath path;
+            ASSERT_TRUE(generator.findPath(placement, path));
+            tetris::Game replay = game;
+            replay.applyPath(path);
+            EXPECT_EQ(replay.getBoard().getHash(), expected.getHash());
+        }
+
+        tetris::AI::Move best = ai.findBestMove(game);
+        game.applyPath(best.path);
+    }
+}
+
+// Test that every path, played input by input with the game's own moves and
+// rotations, leaves the piece exactly on its placement. Random placements
+// stack up into the spawn rows, where a rotation partway through a path can
+// be blocked and the search has to go around it.
+TEST(MoveGeneratorTest, PathsSteerGameOntoPlacements) {
+    tetris::MoveGenerator generator;
+    int checked = 0;
+    for (std::uint64_t seed = 1; seed <= 24; seed++) {
+        tetris::Game game(seed);
+        for (std::uint64_t move = 0;
+             move < 40 && game.getState() == tetris::GameState::PLAYING; move++) {
+            std::vector<tetris::MoveGenerator::Placement> placements =
+                generator.generate(game.getBoard(), game.getCurrentPiece(),
+                                   game.getCurrentPosition());
+            ASSERT_FALSE(placements.empty());
+            for (const auto &placement : placements) {
+                tetris::InputPath path;
+                ASSERT_TRUE(generator.findPath(placement, path));
+                ASSERT_GT(path.length, 0);
+                EXPECT_EQ(path.inputs[static_cast<std::size_t>(path.length - 1)],
+                          tetris::Input::DROP);
+
+                tetris::Game replay = game;
+                for (int i = 0; i + 1 < path.length; i++) {
+                    replay.applyInput(path.inputs[static_cast<std::size_t>(i)]);
+                }
+                // Nothing locked on the way, and the hard drop lands on target
+                ASSERT_EQ(replay.getBoard().getHash(), game.getBoard().getHash());
+                tetris::Position pos = replay.getCurrentPosition();
+                while (replay.getBoard().canPlace(replay.getCurrentPiece(),
+                                                  {pos.x, pos.y + 1})) {
+                    pos.y++;
+                }
+                EXPECT_EQ(replay.getCurrentPiece().getRotation(), placement.rotation);
+                EXPECT_EQ(pos.x, placement.pos.x);
+                EXPECT_EQ(pos.y, placement.pos.y);
+                checked++;
+            }
+
+            const auto &next =
+                placements[tetris::mixBits(seed * 1000 + move) % placements.size()];
+            game.applyPlacement(next.rotation, next.pos);
+        }
+    }
+    EXPECT_GT(checked, 10000);
+}
+
 // Test AI evaluation function
 TEST(AITest, EvaluatePosition) {
     tetris::AI ai;
@@ -110,6 +671,199 @@ TEST(AITest, FindBestMove) {
     EXPECT_GT(move.score, std::numeric_limits<int>::min());
 }
 
+// Test that every batch kernel reproduces evaluatePosition exactly
+TEST(AITest, BatchEvaluatorMatchesEvaluatePosition) {
+    tetris::AI ai;
+    tetris::Board board;
+    tetris::BatchEvaluator batch;
+    std::vector<int> expected;
+    std::vector<int> scores;
+    std::mt19937 rng(7);
+
+    for (int step = 0; step < 60 && !board.isGameOver(); step++) {
+        tetris::Tetromino piece(static_cast<tetris::TetrominoType>(rng() % 7));
+
+        batch.clear();
+        expected.clear();
+        for (int rotation = 0; rotation < 4; rotation++, piece.rotate()) {
+            for (int x = -3; x < board.getWidth() + 3; x++) {
+                tetris::Position pos{x, 0};
+                if (!board.canPlace(piece, pos)) {
+                    continue;
+                }
+                while (board.canPlace(piece, {x, pos.y + 1})) {
+                    pos.y++;
+                }
+                expected.push_back(ai.evaluatePosition(board, piece, pos));
+                tetris::Board result = board;
+                result.place(piece, pos);
+                batch.add(result, result.clearLines());
+            }
+        }
+
+        for (auto level : {tetris::SimdLevel::SCALAR, tetris::SimdLevel::SSE2,
+                           tetris::SimdLevel::AVX2}) {
+            batch.evaluate(scores, level);
+            EXPECT_EQ(scores, expected);
+        }
+
+        // Advance the board with an arbitrary legal drop
+        tetris::Position pos{static_cast<int>(rng() % 8), 0};
+        if (board.canPlace(piece, pos)) {
+            while (board.canPlace(piece, {pos.x, pos.y + 1})) {
+                pos.y++;
+            }
+            board.place(piece, pos);
+            board.clearLines();
+        }
+    }
+}
+
+// Test that weights set at runtime reach every scoring path
+TEST(AITest, RuntimeWeights) {
+    tetris::Game game(3);
+    tetris::AI ai;
+    tetris::EvalWeights holes_only{0.0, 0.0, -1.0, 0.0};
+    ai.setWeights(holes_only);
+    EXPECT_EQ(ai.getWeights().holes, -1.0);
+
+    // An empty board has a hole-free placement for every piece
+    EXPECT_EQ(ai.findBestMove(game).score, 0);
+
+    // Only holes count now: an I laid over an O covers two columns
+    tetris::Board board;
+    board.place(tetris::Tetromino(tetris::TetrominoType::O), {0, 18});
+    EXPECT_EQ(ai.evaluatePosition(board, tetris::Tetromino(tetris::TetrominoType::I), {0, 17}),
+              -4000);
+    board.place(tetris::Tetromino(tetris::TetrominoType::I), {0, 17});
+    ASSERT_EQ(board.getHoles(), 4);
+
+    tetris::BatchEvaluator batch;
+    batch.setWeights(holes_only);
+    batch.add(board, 0);
+    std::vector<int> scores;
+    for (auto level : {tetris::SimdLevel::SCALAR, tetris::SimdLevel::SSE2,
+                       tetris::SimdLevel::AVX2}) {
+        batch.evaluate(scores, level);
+        EXPECT_EQ(scores, std::vector<int>{-4000});
+    }
+}
+
+// Test that the beam search looks ahead and still returns a legal move
+TEST(AITest, BeamSearchFindsMove) {
+    tetris::Game game;
+    tetris::AI greedy;
+    tetris::AI beam({3, 4});
+
+    greedy.findBestMove(game);
+    tetris::AI::Move beam_move = beam.findBestMove(game);
+    EXPECT_GE(beam_move.rotation, 0);
+    EXPECT_LT(beam_move.rotation, 4);
+    EXPECT_GT(beam_move.score, std::numeric_limits<int>::min());
+    // Three pieces deep expands far more boards than one
+    EXPECT_GT(beam.getNodesSearched(), 2 * greedy.getNodesSearched());
+
+    // Without a preview there is nothing to look ahead at
+    game.setPreviewSize(0);
+    tetris::AI blind({3, 4});
+    tetris::AI::Move blind_move = blind.findBestMove(game);
+    tetris::AI::Move one_ply = greedy.findBestMove(game);
+    EXPECT_EQ(blind_move.rotation, one_ply.rotation);
+    EXPECT_EQ(blind_move.x, one_ply.x);
+    EXPECT_EQ(blind_move.score, one_ply.score);
+}
+
+// Test that searching on a thread pool picks exactly the serial move
+TEST(AITest, ParallelSearchMatchesSerial) {
+    tetris::ThreadPool pool(4);
+    EXPECT_EQ(pool.getNumThreads(), 4);
+    std::vector<int> squares(100);
+    pool.parallelFor(100, [&](int i) { squares[static_cast<std::size_t>(i)] = i * i; });
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(squares[static_cast<std::size_t>(i)], i * i);
+    }
+
+    for (int depth : {1, 3}) {
+        tetris::Game game;
+        game.setPreviewSize(depth - 1);
+        tetris::AI serial({depth, 8});
+        tetris::AI shared({depth, 8});
+        shared.setThreadPool(&pool);
+        tetris::AI owned({depth, 8, 1024, 3});
+
+        for (int i = 0; i < 40 && game.getState() == tetris::GameState::PLAYING; i++) {
+            tetris::AI::Move expected = serial.findBestMove(game);
+            for (tetris::AI *ai : {&shared, &owned}) {
+                tetris::AI::Move move = ai->findBestMove(game);
+                EXPECT_EQ(move.rotation, expected.rotation);
+                EXPECT_EQ(move.x, expected.x);
+                EXPECT_EQ(move.score, expected.score);
+            }
+
+            // Play the move so the positions get more varied
+            game.applyPath(expected.path);
+        }
+    }
+}
+
+// Test that the beam search keeps the same boards whatever the table size,
+// the table only caches scores and never decides which boards are distinct
+TEST(AITest, BeamSearchIgnoresTableSize) {
+    tetris::Game game(3);
+    game.setPreviewSize(3);
+    tetris::AI cached({4, 3, 1024});
+    tetris::AI tiny({4, 3, 1});
+    tetris::AI uncached({4, 3, 0});
+
+    for (int i = 0; i < 300 && game.getState() == tetris::GameState::PLAYING; i++) {
+        tetris::AI::Move expected = cached.findBestMove(game);
+        for (tetris::AI *ai : {&tiny, &uncached}) {
+            tetris::AI::Move move = ai->findBestMove(game);
+            EXPECT_EQ(move.rotation, expected.rotation);
+            EXPECT_EQ(move.x, expected.x);
+            EXPECT_EQ(move.score, expected.score);
+        }
+        game.applyPath(expected.path);
+    }
+}
+
+// Test bucket replacement and hit counting in the transposition table
+TEST(AITest, TranspositionTable) {
+    tetris::TranspositionTable table(1);
+    int value = 0;
+    EXPECT_FALSE(table.probe(42, value));
+
+    for (int key = 1; key <= tetris::TranspositionTable::ENTRIES_PER_BUCKET; key++) {
+        table.store(static_cast<std::uint64_t>(key), key * 10);
+    }
+    EXPECT_TRUE(table.probe(3, value));
+    EXPECT_EQ(value, 30);
+
+    // A full bucket evicts the first entry of the oldest generation. Storing
+    // key 1 again moves it to the new one.
+    table.nextGeneration();
+    table.store(1, 11);
+    table.store(100, 1000);
+    EXPECT_TRUE(table.probe(1, value));
+    EXPECT_EQ(value, 11);
+    EXPECT_FALSE(table.probe(2, value));
+    EXPECT_TRUE(table.probe(100, value));
+    EXPECT_EQ(table.getStats().replacements, 1u);
+    EXPECT_EQ(table.getStats().hits, 3u);
+
+    // Repeating a search is answered from the table with identical results
+    tetris::AI ai;
+    tetris::Game game;
+    tetris::AI::Move first = ai.findBestMove(game);
+    auto misses = ai.getNodesSearched();
+    tetris::AI::Move second = ai.findBestMove(game);
+    EXPECT_EQ(ai.getNodesSearched(), misses);
+    EXPECT_EQ(first.rotation, second.rotation);
+    EXPECT_EQ(first.x, second.x);
+    EXPECT_EQ(first.score, second.score);
+    EXPECT_GT(ai.getTranspositionTable().getHitRate(), 0.0);
+}
+
 // Test multi-player game initialization
 TEST(MultiPlayerTest, Initialization) {
     tetris::MultiPlayerGame mp_game(3);
@@ -119,10 +873,10 @@ TEST(MultiPlayerTest, Initialization) {
     EXPECT_EQ(mp_game.getActivePlayers(), 3);
     
     // Check each game is initialized
+    const tetris::GameBatch &games = mp_game.getGames();
     for (int i = 0; i < 3; i++) {
-        const tetris::Game &game = mp_game.getGame(i);
-        EXPECT_EQ(game.getState(), tetris::GameState::PLAYING);
-        EXPECT_EQ(game.getScore(), 0);
+        EXPECT_EQ(games.getState(i), tetris::GameState::PLAYING);
+        EXPECT_EQ(games.getScore(i), 0);
     }
 }
 
@@ -139,10 +893,11 @@ TEST(MultiPlayerTest, Reset) {
     
     // All games should be back to initial state
     EXPECT_EQ(mp_game.getActivePlayers(), 2);
+    const tetris::GameBatch &games = mp_game.getGames();
     for (int i = 0; i < 2; i++) {
-        const tetris::Game &game = mp_game.getGame(i);
-        EXPECT_EQ(game.getState(), tetris::GameState::PLAYING);
-        EXPECT_EQ(game.getScore(), 0);
+        EXPECT_EQ(games.getState(i), tetris::GameState::PLAYING);
+        EXPECT_EQ(games.getScore(i), 0);
+        EXPECT_EQ(games.getPieceCount(i), 0);
     }
 }
 
@@ -160,3 +915,594 @@ TEST(MultiPlayerTest, Update) {
     EXPECT_TRUE(mp_game.isAnyPlaying());
 }
 
+// Test that a seeded match plays out the same on any number of threads
+TEST(MultiPlayerTest, ParallelUpdateMatchesSerial) {
+    tetris::MultiPlayerGame serial(6, 7);
+    serial.setThreads(1);
+    tetris::MultiPlayerGame parallel(6, 7);
+    parallel.setThreads(4);
+    EXPECT_EQ(parallel.getThreads(), 4);
+
+    for (int tick = 0; tick < 60; tick++) {
+        serial.update();
+        parallel.update();
+    }
+    const tetris::GameBatch &expected = serial.getGames();
+    const tetris::GameBatch &games = parallel.getGames();
+    for (int i = 0; i < 6; i++) {
+        EXPECT_EQ(games.getScore(i), expected.getScore(i));
+        EXPECT_EQ(games.getLinesCleared(i), expected.getLinesCleared(i));
+        EXPECT_EQ(games.getState(i), expected.getState(i));
+        EXPECT_EQ(games.getCurrentPiece(i).getType(), expected.getCurrentPiece(i).getType());
+        for (int y = 0; y < tetris::BOARD_HEIGHT; y++) {
+            EXPECT_EQ(games.getBoard(i).getRow(y), expected.getBoard(i).getRow(y));
+        }
+    }
+
+    // Different players get different pieces from the same match seed
+    int matching = 0;
+    for (int i = 1; i < 6; i++) {
+        matching += expected.getBoard(i).getHash() == expected.getBoard(0).getHash();
+    }
+    EXPECT_LT(matching, 5);
+}
+
+// Test that batched games play exactly like Game objects driven by an AI
+TEST(GameBatchTest, MatchesSeparateGames) {
+    for (int depth : {1, 2}) {
+        tetris::AI::SearchConfig search;
+        search.depth = depth;
+        tetris::GameBatch batch(5, 21, tetris::RandomizerKind::BAG, 2);
+        batch.setThreads(2);
+        batch.setSearchConfig(search);
+        batch.setPieceLimit(depth == 1 ? 300 : 60);
+        while (batch.getActiveGames() > 0) {
+            batch.step();
+        }
+
+        for (int i = 0; i < batch.getNumGames(); i++) {
+            tetris::Game game(tetris::gameSeed(21, i), tetris::RandomizerKind::BAG);
+            game.setPreviewSize(2);
+            tetris::AI ai(search);
+            int pieces = 0;
+            while (game.getState() == tetris::GameState::PLAYING &&
+                   pieces < batch.getPieceCount(i)) {
+                tetris::AI::Move move = ai.findBestMove(game);
+                if (!game.applyPlacement(move.rotation, {move.x, move.y})) {
+                    game.drop();
+                }
+                pieces++;
+            }
+            EXPECT_EQ(batch.getSeed(i), tetris::gameSeed(21, i));
+            EXPECT_EQ(batch.getScore(i), game.getScore());
+            EXPECT_EQ(batch.getLinesCleared(i), game.getLinesCleared());
+            EXPECT_EQ(batch.getLevel(i), game.getLevel());
+            EXPECT_EQ(batch.getState(i), game.getState());
+            EXPECT_EQ(batch.getBoard(i).getHash(), game.getBoard().getHash());
+            EXPECT_EQ(batch.getCurrentPiece(i).getType(), game.getCurrentPiece().getType());
+            EXPECT_EQ(batch.getPreview(i, 1), game.getPreview(1));
+        }
+    }
+
+    // Per-game state is a small fraction of what a Game and its own AI cost
+    tetris::GameBatch batch(100, 1);
+    EXPECT_LT(tetris::GameBatch::getBytesPerGame(), 512U);
+    EXPECT_GT(batch.getMemoryUsage(), 100 * tetris::GameBatch::getBytesPerGame());
+    EXPECT_EQ(batch.getActiveGames(), 100);
+}
+
+// Test that uneven and nested jobs run every index exactly once
+TEST(ThreadPoolTest, RunsEveryIndexOnce) {
+    tetris::ThreadPool pool(3);
+    for (int count : {0, 1, 2, 7, 100}) {
+        std::vector<std::atomic<int>> runs(static_cast<std::size_t>(count));
+        pool.parallelFor(count, [&](int i) {
+            // Later indices are much slower, so threads have to steal
+            volatile int spin = 0;
+            for (int k = 0; k < i * 1000; k++) {
+                spin = spin + 1;
+            }
+            pool.parallelFor(2, [&](int) {});
+            runs[static_cast<std::size_t>(i)]++;
+        });
+        for (auto &run : runs) {
+            EXPECT_EQ(run.load(), 1);
+        }
+    }
+}
+
+// Test that parallelForWorkers() names each thread by an index no other
+// running call shares, inline nested calls included
+TEST(ThreadPoolTest, WorkerIndexIsExclusive) {
+    tetris::ThreadPool pool(3);
+    std::vector<std::atomic<int>> busy(static_cast<std::size_t>(pool.getNumThreads()));
+    std::atomic<int> overlaps{0};
+    std::atomic<int> runs{0};
+    pool.parallelForWorkers(60, [&](int worker, int i) {
+        ASSERT_GE(worker, 0);
+        ASSERT_LT(worker, pool.getNumThreads());
+        auto &flag = busy[static_cast<std::size_t>(worker)];
+        if (flag.fetch_add(1) != 0) {
+            overlaps++;
+        }
+        volatile int spin = 0;
+        for (int k = 0; k < (i % 7) * 2000; k++) {
+            spin = spin + 1;
+        }
+        pool.parallelForWorkers(2, [&](int inner, int) {
+            if (inner != worker) {
+                overlaps++;
+            }
+        });
+        flag--;
+        runs++;
+    });
+    EXPECT_EQ(overlaps.load(), 0);
+    EXPECT_EQ(runs.load(), 60);
+}
+
+// Test that the fixed timestep hands out steps by elapsed time, not by polls
+TEST(GameLoopTest, FixedTimestepPacing) {
+    using namespace std::chrono_literals;
+    auto start = tetris::FixedTimestep::Clock::time_point{};
+    tetris::FixedTimestep timestep(10ms, 1.0, start);
+    EXPECT_EQ(timestep.advance(start + 5ms), 0);
+    EXPECT_EQ(timestep.advance(start + 10ms), 1);
+    EXPECT_EQ(timestep.advance(start + 10ms), 0);
+    EXPECT_EQ(timestep.advance(start + 45ms), 3);
+    EXPECT_EQ(timestep.nextStepTime(), start + 50ms);
+
+    // A long stall is cut short instead of replayed
+    EXPECT_EQ(timestep.advance(start + 1s), tetris::FixedTimestep::MAX_CATCH_UP);
+    EXPECT_EQ(timestep.advance(start + 1s), 0);
+
+    // Double speed halves the step
+    timestep.setSpeed(2.0, start + 2s);
+    EXPECT_EQ(timestep.advance(start + 2s + 20ms), 4);
+
+    timestep.setSpeed(0.0, start + 3s);
+    EXPECT_TRUE(timestep.isUnlimited());
+    EXPECT_EQ(timestep.advance(start + 3s), tetris::FixedTimestep::UNLIMITED_BATCH);
+
+    // Readers only get a value they have not seen yet
+    tetris::TripleBuffer<int> latest;
+    latest.publish(1);
+    latest.publish(2);
+    EXPECT_TRUE(latest.fetch());
+    EXPECT_EQ(latest.read(), 2);
+    EXPECT_FALSE(latest.fetch());
+    EXPECT_EQ(latest.read(), 2);
+}
+
+// Test that snapshots read while the simulation publishes are never torn
+TEST(GameLoopTest, SnapshotsStayConsistent) {
+    tetris::Game game;
+    game.drop();
+    tetris::GameSnapshot snapshot;
+    game.captureSnapshot(snapshot);
+    EXPECT_EQ(snapshot.state, tetris::GameState::PLAYING);
+    EXPECT_EQ(snapshot.score, game.getScore());
+    EXPECT_EQ(snapshot.piece, game.getCurrentPiece().getType());
+    EXPECT_EQ(snapshot.pos.y, game.getCurrentPosition().y);
+    for (int y = 0; y < tetris::BOARD_HEIGHT; y++) {
+        for (int x = 0; x < tetris::BOARD_WIDTH; x++) {
+            EXPECT_EQ(snapshot.cells[static_cast<std::size_t>(y)][static_cast<std::size_t>(x)],
+                      game.getBoard().getCell(x, y));
+        }
+    }
+
+    // Every published frame has all its fields set to the same counter, a
+    // torn read would mix two of them
+    constexpr int FRAMES = 20000;
+    tetris::TripleBuffer<tetris::GameSnapshot> buffer;
+    std::thread writer([&] {
+        for (int i = 1; i <= FRAMES; i++) {
+            tetris::GameSnapshot &slot = buffer.writeSlot();
+            for (auto &row : slot.cells) {
+                row.fill(static_cast<std::uint8_t>(i));
+            }
+            slot.score = i;
+            slot.level = i;
+            slot.lines = i;
+            buffer.publish();
+        }
+    });
+    int last = 0;
+    while (last < FRAMES) {
+        if (!buffer.fetch()) {
+            std::this_thread::yield();
+            continue;
+        }
+        const tetris::GameSnapshot &frame = buffer.read();
+        ASSERT_GT(frame.score, last);
+        ASSERT_EQ(frame.level, frame.score);
+        ASSERT_EQ(frame.lines, frame.score);
+        auto byte = static_cast<std::uint8_t>(frame.score);
+        for (const auto &row : frame.cells) {
+            for (std::uint8_t cell : row) {
+                ASSERT_EQ(cell, byte);
+            }
+        }
+        last = frame.score;
+    }
+    writer.join();
+}
+
+// Test that the league view ranks every player but copies only the page
+TEST(MultiPlayerTest, LeagueViewPages) {
+    tetris::MultiPlayerGame match(40, 3);
+    match.setThreads(1);
+    for (int tick = 0; tick < 30; tick++) {
+        match.update();
+    }
+
+    const tetris::GameBatch &games = match.getGames();
+    std::vector<tetris::PlayerStanding> expected;
+    for (int i = 0; i < match.getNumPlayers(); i++) {
+        expected.push_back({i, games.getScore(i), games.getLinesCleared(i),
+                            games.getLevel(i), games.getState(i)});
+    }
+    std::sort(expected.begin(), expected.end(), tetris::ranksAbove);
+
+    tetris::LeagueView view;
+    auto frame = std::make_unique<tetris::LeagueFrame>();
+    tetris::PageRequest page{tetris::PageOrder::RANK, 12, 6};
+    view.capture(match, page, *frame);
+    EXPECT_EQ(frame->num_players, 40);
+    EXPECT_EQ(frame->active_players, match.getActivePlayers());
+    ASSERT_EQ(frame->num_leaders, tetris::LEADERBOARD_SIZE);
+    for (int i = 0; i < frame->num_leaders; i++) {
+        EXPECT_EQ(frame->leaders[static_cast<std::size_t>(i)].player,
+                  expected[static_cast<std::size_t>(i)].player);
+    }
+    ASSERT_EQ(frame->num_boards, 6);
+    for (int i = 0; i < 6; i++) {
+        auto slot = static_cast<std::size_t>(i);
+        EXPECT_EQ(frame->board_ranks[slot], 12 + i);
+        EXPECT_EQ(frame->board_players[slot], expected[slot + 12].player);
+        EXPECT_EQ(frame->boards[slot].score, expected[slot + 12].score);
+    }
+
+    // Pages by player number stop at the last player
+    page = {tetris::PageOrder::PLAYER, 37, 6};
+    view.capture(match, page, *frame);
+    ASSERT_EQ(frame->num_boards, 3);
+    EXPECT_EQ(frame->board_players[0], 37);
+    EXPECT_EQ(frame->board_ranks[0], -1);
+    EXPECT_EQ(frame->boards[2].lines, games.getLinesCleared(39));
+}
+
+// Test that headless runs are reproducible and summarized correctly
+TEST(SimulationTest, SeededRunsAreReproducible) {
+    tetris::SimulationConfig config;
+    config.games = 5;
+    config.piece_cap = 60;
+    config.seed = 11;
+    config.threads = 1;
+    std::vector<tetris::GameResult> serial = tetris::runSimulation(config);
+    config.threads = 3;
+    std::vector<tetris::GameResult> parallel = tetris::runSimulation(config);
+
+    ASSERT_EQ(serial.size(), 5u);
+    ASSERT_EQ(parallel.size(), 5u);
+    for (std::size_t i = 0; i < serial.size(); i++) {
+        EXPECT_EQ(parallel[i].seed, tetris::gameSeed(11, static_cast<int>(i)));
+        EXPECT_EQ(parallel[i].score, serial[i].score);
+        EXPECT_EQ(parallel[i].lines, serial[i].lines);
+        EXPECT_EQ(parallel[i].pieces, serial[i].pieces);
+        EXPECT_LE(serial[i].pieces, 60);
+    }
+    // The batched run plays each game as playGame does on its own
+    tetris::GameResult single = tetris::playGame(tetris::gameSeed(11, 3), config);
+    EXPECT_EQ(single.score, serial[3].score);
+    EXPECT_EQ(single.pieces, serial[3].pieces);
+
+    std::vector<tetris::GameResult> results;
+    for (int lines = 1; lines <= 100; lines++) {
+        results.push_back({0, lines * 10, lines, 100, lines % 2 == 0});
+    }
+    tetris::SimulationSummary summary = tetris::summarize(results);
+    EXPECT_EQ(summary.games, 100);
+    EXPECT_EQ(summary.pieces, 10000);
+    EXPECT_EQ(summary.topped_out, 50);
+    EXPECT_DOUBLE_EQ(summary.lines.mean, 50.5);
+    EXPECT_EQ(summary.lines.min, 1);
+    EXPECT_EQ(summary.lines.p50, 50);
+    EXPECT_EQ(summary.lines.p90, 90);
+    EXPECT_EQ(summary.lines.p99, 99);
+    EXPECT_EQ(summary.score.max, 1000);
+}
+
+// Test that other board sizes play through the dispatcher as they do directly
+TEST(SimulationTest, RunsOnOtherBoardSizes) {
+    tetris::SimulationConfig config;
+    config.games = 3;
+    config.piece_cap = 120;
+    config.seed = 5;
+    config.threads = 2;
+    config.board_width = 16;
+    config.board_height = 40;
+    std::vector<tetris::GameResult> results = tetris::runSimulation(config);
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(tetris::getBytesPerGame(config), sizeof(tetris::BasicGame<16, 40>));
+
+    tetris::BasicGame<16, 40> game(tetris::gameSeed(5, 1));
+    tetris::BasicAI<16, 40> ai;
+    int pieces = 0;
+    for (; pieces < 120 && game.getState() == tetris::GameState::PLAYING; pieces++) {
+        tetris::AI::Move move = ai.findBestMove(game);
+        if (!game.applyPlacement(move.rotation, {move.x, move.y})) {
+            game.drop();
+        }
+    }
+    EXPECT_GT(game.getLinesCleared(), 0);
+    EXPECT_EQ(results[1].score, game.getScore());
+    EXPECT_EQ(results[1].lines, game.getLinesCleared());
+    EXPECT_EQ(results[1].pieces, pieces);
+}
+
+// Test that a tuning run resumed from a checkpoint matches an unbroken run
+TEST(TunerTest, ResumeMatchesUninterruptedRun) {
+    tetris::TunerConfig config;
+    config.population = 5;
+    config.games = 2;
+    config.piece_cap = 40;
+    config.elite = 1;
+    config.threads = 2;
+    config.seed = 9;
+
+    tetris::Tuner unbroken(config);
+    for (int i = 0; i < 3; i++) {
+        unbroken.runGeneration();
+    }
+    ASSERT_EQ(unbroken.getScored().size(), 5u);
+    for (const auto &candidate : unbroken.getScored()) {
+        EXPECT_GE(candidate.fitness, unbroken.getScored().back().fitness);
+        const tetris::EvalWeights &w = candidate.weights;
+        EXPECT_NEAR(w.lines * w.lines + w.height * w.height + w.holes * w.holes +
+                        w.bumpiness * w.bumpiness,
+                    1.0, 1e-9);
+    }
+
+    std::string path = ::testing::TempDir() + "tetris_tuner_checkpoint.txt";
+    tetris::Tuner first(config);
+    first.runGeneration();
+    ASSERT_TRUE(first.saveCheckpoint(path));
+
+    tetris::Tuner resumed(config);
+    ASSERT_TRUE(resumed.loadCheckpoint(path));
+    EXPECT_EQ(resumed.getGeneration(), 1);
+    resumed.runGeneration();
+    resumed.runGeneration();
+    ASSERT_EQ(resumed.getScored().size(), unbroken.getScored().size());
+    for (std::size_t i = 0; i < unbroken.getScored().size(); i++) {
+        EXPECT_EQ(resumed.getScored()[i].fitness, unbroken.getScored()[i].fitness);
+        EXPECT_EQ(resumed.getScored()[i].weights.holes,
+                  unbroken.getScored()[i].weights.holes);
+    }
+
+    // Checkpoints from another run are refused, as are ones saved with any
+    // other setting that changes the results, such as the piece cap
+    tetris::TunerConfig other_seed = config;
+    other_seed.seed = 10;
+    tetris::TunerConfig other_population = config;
+    other_population.population = 6;
+    tetris::TunerConfig other_games = config;
+    other_games.games = 3;
+    tetris::TunerConfig other_piece_cap = config;
+    other_piece_cap.piece_cap = 41;
+    tetris::TunerConfig other_mutation = config;
+    other_mutation.mutation_step = 0.25;
+    tetris::TunerConfig other_search = config;
+    other_search.search.beam_width = 4;
+    for (const auto &other_config : {other_seed, other_population, other_games,
+                                     other_piece_cap, other_mutation, other_search}) {
+        tetris::Tuner other(other_config);
+        EXPECT_FALSE(other.loadCheckpoint(path));
+        EXPECT_EQ(other.getGeneration(), 0);
+    }
+    std::remove(path.c_str());
+}
+
+// Test that a recorded game seeks to any piece and re-simulates to its score
+TEST(ReplayTest, RecordSeekVerify) {
+    constexpr int PIECES = 300;
+    tetris::Game game(21);
+    tetris::ReplayRecorder recorder(21, tetris::RandomizerKind::UNIFORM, 16);
+    game.setRecorder(&recorder);
+    tetris::AI ai;
+    std::vector<tetris::GameSnapshot> before;
+    while (game.getState() == tetris::GameState::PLAYING &&
+           static_cast<int>(before.size()) < PIECES) {
+        before.emplace_back();
+        game.captureSnapshot(before.back());
+        tetris::AI::Move move = ai.findBestMove(game);
+        // Steer every other piece with its inputs so both record kinds occur
+        if (before.size() % 2 == 0) {
+            game.applyPath(move.path);
+        } else {
+            ASSERT_TRUE(game.applyPlacement(move.rotation, {move.x, move.y}));
+        }
+        ASSERT_EQ(recorder.getPieceCount(), static_cast<int>(before.size()));
+    }
+    EXPECT_LT(recorder.getStreamBytes(), before.size() * 8);
+
+    std::string path = ::testing::TempDir() + "tetris_replay.trp";
+    ASSERT_TRUE(recorder.save(path, game));
+    tetris::ReplayFile replay;
+    ASSERT_TRUE(replay.open(path));
+    EXPECT_EQ(replay.getPieceCount(), static_cast<int>(before.size()));
+    EXPECT_EQ(replay.getRecordedScore(), game.getScore());
+
+    tetris::ReplayCheck check = replay.verify();
+    EXPECT_TRUE(check.ok);
+    EXPECT_EQ(check.score, game.getScore());
+    EXPECT_EQ(check.lines, game.getLinesCleared());
+
+    tetris::ReplayState state;
+    for (int piece : {0, 1, 15, 16, 17, 150, static_cast<int>(before.size()) - 1}) {
+        ASSERT_TRUE(replay.seek(piece, state));
+        const tetris::GameSnapshot &expected = before[static_cast<std::size_t>(piece)];
+        EXPECT_EQ(state.piece, piece);
+        EXPECT_EQ(state.score, expected.score);
+        EXPECT_EQ(state.lines, expected.lines);
+        ASSERT_TRUE(state.has_next);
+        EXPECT_EQ(state.next.getType(), expected.piece);
+        EXPECT_EQ(state.next_path.length > 0, piece % 2 == 1);
+        for (int y = 0; y < tetris::BOARD_HEIGHT; y++) {
+            for (int x = 0; x < tetris::BOARD_WIDTH; x++) {
+                EXPECT_EQ(state.board.getCell(x, y),
+                          expected.cells[static_cast<std::size_t>(y)][static_cast<std::size_t>(x)]);
+            }
+        }
+    }
+    ASSERT_TRUE(replay.seek(replay.getPieceCount(), state));
+    EXPECT_FALSE(state.has_next);
+    EXPECT_EQ(state.score, game.getScore());
+    EXPECT_FALSE(replay.seek(replay.getPieceCount() + 1, state));
+
+    // A changed score no longer verifies
+    replay.close();
+    std::FILE *file = std::fopen(path.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    std::fseek(file, 32, SEEK_SET);
+    std::fputc(0x7F, file);
+    std::fclose(file);
+    ASSERT_TRUE(replay.open(path));
+    EXPECT_FALSE(replay.verify().ok);
+    std::remove(path.c_str());
+}
+
+// Test that a piece count on a keyframe boundary ends with a closing
+// keyframe, so seeking to the final board replays no pieces
+TEST(ReplayTest, SeekEndOnKeyframeBoundary) {
+    std::string path = ::testing::TempDir() + "tetris_replay_boundary.trp";
+    for (int pieces : {0, 32}) {
+        tetris::Game game(5);
+        tetris::ReplayRecorder recorder(5, tetris::RandomizerKind::UNIFORM, 16);
+        game.setRecorder(&recorder);
+        tetris::AI ai;
+        while (recorder.getPieceCount() < pieces) {
+            ASSERT_EQ(game.getState(), tetris::GameState::PLAYING);
+            tetris::AI::Move move = ai.findBestMove(game);
+            ASSERT_TRUE(game.applyPlacement(move.rotation, {move.x, move.y}));
+        }
+        ASSERT_TRUE(recorder.save(path, game));
+
+        // Keyframes before pieces 0 and 16, and a closing one after piece 31
+        std::FILE *file = std::fopen(path.c_str(), "rb");
+        ASSERT_NE(file, nullptr);
+        std::fseek(file, 20, SEEK_SET);
+        EXPECT_EQ(std::fgetc(file), pieces / 16 + 1);
+        std::fclose(file);
+
+        tetris::ReplayFile replay;
+        ASSERT_TRUE(replay.open(path));
+        EXPECT_TRUE(replay.verify().ok);
+        tetris::ReplayState state;
+        ASSERT_TRUE(replay.seek(pieces, state));
+        EXPECT_EQ(state.piece, pieces);
+        EXPECT_FALSE(state.has_next);
+        EXPECT_EQ(state.score, game.getScore());
+        EXPECT_EQ(state.lines, game.getLinesCleared());
+        for (int y = 0; y < tetris::BOARD_HEIGHT; y++) {
+            for (int x = 0; x < tetris::BOARD_WIDTH; x++) {
+                EXPECT_EQ(state.board.getCell(x, y), game.getBoard().getCell(x, y));
+            }
+        }
+    }
+    std::remove(path.c_str());
+}
+
+// Test that latency percentiles stay within the histogram's precision
+TEST(ProfilerTest, HistogramPercentiles) {
+    using Histogram = tetris::LatencyHistogram;
+    for (std::uint64_t value : {0ULL, 63ULL, 64ULL, 1000ULL, 123456789ULL, ~0ULL >> 1}) {
+        int index = Histogram::bucketIndex(value);
+        ASSERT_LT(index, Histogram::NUM_BUCKETS);
+        EXPECT_EQ(Histogram::bucketIndex(Histogram::bucketValue(index)), index);
+        EXPECT_NEAR(static_cast<double>(Histogram::bucketValue(index)),
+                    static_cast<double>(value), static_cast<double>(value) * 0.04);
+    }
+
+    Histogram histogram;
+    EXPECT_EQ(histogram.getPercentile(50.0), 0U);
+    // Microseconds 1-1000, in nanoseconds
+    for (std::uint64_t us = 1; us <= 1000; us++) {
+        histogram.record(us * 1000);
+    }
+    EXPECT_EQ(histogram.getCount(), 1000U);
+    EXPECT_EQ(histogram.getMax(), 1000000U);
+    EXPECT_DOUBLE_EQ(histogram.getMean(), 500500.0);
+    EXPECT_NEAR(static_cast<double>(histogram.getPercentile(50.0)), 500000.0, 15000.0);
+    EXPECT_NEAR(static_cast<double>(histogram.getPercentile(99.0)), 990000.0, 30000.0);
+    EXPECT_EQ(histogram.getPercentile(100.0), 1000000U);
+    histogram.reset();
+    EXPECT_EQ(histogram.getCount(), 0U);
+
+    // The exports list every probe, sampled or not
+    std::string csv = tetris::formatProbesCsv();
+    std::string json = tetris::formatProbesJson();
+    for (int i = 0; i < tetris::NUM_PROBES; i++) {
+        std::string name = tetris::probeName(static_cast<tetris::Probe>(i));
+        EXPECT_NE(csv.find("\n" + name + ","), std::string::npos);
+        EXPECT_NE(json.find("\"" + name + "\""), std::string::npos);
+    }
+}
+
+namespace {
+
+// Let the AI lock pieces pieces, starting over when the game tops out, and
+// return the allocations made per piece
+double allocationsPerPiece(tetris::Game &game, tetris::AI &ai, int pieces) {
+    tetris::testing::AllocationScope scope;
+    for (int i = 0; i < pieces; i++) {
+        if (game.getState() != tetris::GameState::PLAYING) {
+            game.reset();
+        }
+        tetris::AI::Move move = ai.findBestMove(game);
+        if (i % 2 == 0) {
+            game.applyPath(move.path);
+        } else if (!game.applyPlacement(move.rotation, {move.x, move.y})) {
+            game.drop();
+        }
+    }
+    return static_cast<double>(scope.count()) / pieces;
+}
+
+} // namespace
+
+// Test that once set up, the engine and the AI never touch the heap
+TEST(AllocationTest, SteadyStateIsAllocationFree) {
+    // Greedy, beam and parallel beam searches over real games. The AI sizes
+    // its scratch when it is built, so even its first search is counted.
+    tetris::AI::SearchConfig beam;
+    beam.depth = 3;
+    tetris::AI::SearchConfig parallel = beam;
+    parallel.threads = 2;
+    for (const tetris::AI::SearchConfig &config :
+         {tetris::AI::SearchConfig{}, beam, parallel}) {
+        tetris::Game game(5);
+        tetris::AI ai(config);
+        EXPECT_EQ(allocationsPerPiece(game, ai, 500), 0.0)
+            << "depth " << config.depth << ", threads " << config.threads;
+    }
+
+    // A lockstep batch on a thread pool, and the league view of it that
+    // the multi-player screen publishes every tick
+    tetris::MultiPlayerGame match(64, 9);
+    match.setThreads(2);
+    tetris::LeagueView view;
+    auto frame = std::make_unique<tetris::LeagueFrame>();
+    tetris::PageRequest page{tetris::PageOrder::RANK, 0, 16};
+    for (int tick = 0; tick < 20; tick++) {
+        match.update();
+        view.capture(match, page, *frame);
+    }
+    tetris::testing::AllocationScope scope;
+    for (int tick = 0; tick < 100; tick++) {
+        match.update();
+        view.capture(match, page, *frame);
+    }
+    EXPECT_EQ(scope.count(), 0U);
+}